@@ -6,6 +6,7 @@
 #include "system/common.h"
 #include "system/scheduler.h"
 #include "system/process/table.h"
+#include "system/sync.h"
 
 #define KEYBOARD_IO_PORT 0x60
 #define KEYBOARD_CTRL_PORT 0x64
@@ -14,8 +15,6 @@
 
 #define BUFFER_SIZE 4000
 
-#define WAIT_LEN 20
-
 static unsigned char buffer[BUFFER_SIZE];
 
 static int bufferPos = 0;
@@ -24,8 +23,12 @@ static int bufferStart = 0;
 
 static struct Process* consumer;
 
+// Counts the scancodes in the buffer, the consumer sleeps on it when there are none
+static struct Semaphore scancodes = SEMAPHORE_INIT(0);
+
 void keyboard_consumer(struct Process* p) {
     consumer = p;
+    lock_stats_register("keyboard", &scancodes.stats);
 }
 
 /**
@@ -67,9 +70,7 @@ void keyboard_read(void) {
         bufferPos = 0;
     }
 
-    if (consumer->schedule.ioWait) {
-        process_table_unblock(consumer);
-    }
+    semaphore_up(&scancodes);
 }
 
 unsigned char keyboard_get_code(void) {
@@ -80,14 +81,7 @@ unsigned char keyboard_get_code(void) {
         return ret;
     }
 
-    while (bufferPos == bufferStart) {
-        consumer->schedule.ioWait = 1;
-        process_table_block(consumer);
-
-        yield();
-    }
-
-    consumer->schedule.ioWait = 0;
+    semaphore_down(&scancodes);
 
     ret = buffer[bufferStart++];
     if (bufferStart == BUFFER_SIZE) {
@@ -6,6 +6,7 @@
 #include "system/common.h"
 #include "system/scheduler.h"
 #include "system/process/table.h"
+#include "system/timer.h"
 
 #define LAST_CODE_IN_TABLE 0x39
 #define MIN_BREAK_CODE 0x80
@@ -229,7 +230,11 @@ void process_scancode(void) {
  *
  * The behaviour of this function is determined by the canon flag in termios.
  * If set, this will behave as if input was line buffered, and will return
- * as much as one line. Otherwise, it will behave as the definition implies.
+ * as much as one line. Otherwise, it will behave as the definition implies,
+ * except that if termios.time is set it gives up waiting after that long.
+ *
+ * Only one process reads from a terminal at a time, the others sleep on its
+ * read lock. The one reading inherits their priority while they do.
  *
  * @param buffer a place to write the output to.
  * @param count the number of bytes to read.
@@ -243,10 +248,15 @@ size_t readKeyboard(void* buffer, size_t count) {
         return 0;
     }
 
-    if (!caller->active) {
+    // Input only goes to the foreground, so that's when it's our turn
+    while (!caller->active) {
         wait_for_input(caller);
     }
 
+    // Foreground processes of the same terminal take turns, a whole read each
+    struct Mutex* readLock = &tty_terminal(caller->terminal)->readLock;
+    mutex_lock(readLock);
+
     char* buf = (char*) buffer;
     int i, c = (int) count;
 
@@ -268,9 +278,18 @@ size_t readKeyboard(void* buffer, size_t count) {
         }
     } else {
 
-        while (bufferEnd < c) {
+        unsigned long long timeout = tty_current()->termios.time;
+        process_table_timeout(caller, timer_ticks(timeout * (NSEC_PER_SEC / 10)));
+
+        while (bufferEnd < c && !caller->schedule.timedOut) {
             wait_for_input(caller);
         }
+
+        process_table_timeout(caller, 0);
+
+        if (c > bufferEnd) {
+            c = bufferEnd;
+        }
     }
 
     // If we're here, only we can be holding the ioWait flag, so we release it
@@ -287,6 +306,8 @@ size_t readKeyboard(void* buffer, size_t count) {
     }
     bufferEnd = i;
 
+    mutex_unlock(readLock);
+
     return c;
 }
 
@@ -329,51 +350,28 @@ void set_leds(void) {
     keyboard_leds(kbStatus.caps, kbStatus.num, kbStatus.scroll);
 }
 
-void tty_detach_process(struct Process* process) {
-
-    if (process->terminal == NO_TERMINAL || !process->schedule.ioWait) {
-        return;
-    }
-
-    struct Terminal* me = tty_terminal(process->terminal);
-
-    for (int i = 0; i < WAIT_LEN; i++) {
-
-        if (me->wait[i] == process) {
-            me->wait[i] = NULL;
-        }
-    }
-}
-
 void wake_up(void) {
 
     struct Terminal* active = tty_active();
-    for (int i = 0; i < WAIT_LEN; i++) {
+    struct Process* reader = NULL;
 
-        struct Process* p = active->wait[i];
-        if (p != NULL && p->active) {
-            active->wait[i] = NULL;
-            process_table_unblock(p);
+    // The most urgent reader gets the input first
+    for (struct Process* p = active->wait.processes.first; p != NULL; p = p->queueNext) {
 
-            return;
+        if (p->active && (reader == NULL || p->schedule.priority > reader->schedule.priority)) {
+            reader = p;
         }
     }
+
+    if (reader != NULL) {
+        process_table_unblock(reader);
+    }
 }
 
 void wait_for_input(struct Process* p) {
 
     struct Terminal* terminal = tty_terminal(p->terminal);
-    for (int i = 0; i < WAIT_LEN; i++) {
-
-        if (terminal->wait[i] == NULL) {
-            terminal->wait[i] = p;
-            p->schedule.ioWait = 1;
-            process_table_block(p);
-
-            scheduler_do();
 
-            return;
-        }
-    }
+    p->schedule.ioWait = 1;
+    wait_queue_sleep(&terminal->wait);
 }
-
@@ -3,11 +3,10 @@
 
 #include "drivers/videoControl.h"
 #include "system/call/ioctl/keyboard.h"
+#include "system/sync.h"
 
 #define CONTROL_BUFFER_LEN 40
 
-#define WAIT_LEN 30
-
 struct ScreenStatus {
     int cursorPosition;
     int escaped;
@@ -23,7 +22,9 @@ struct Terminal {
     int active;
     termios termios;
     struct ScreenStatus screen;
-    struct Process* wait[WAIT_LEN];
+    struct WaitQueue wait;
+    // Held by the process reading, so the next one waits for the whole read
+    struct Mutex readLock;
 };
 
 struct Terminal* tty_current(void);
@@ -4,12 +4,20 @@
 #include "type.h"
 #include "system/process/table.h"
 #include "system/scheduler.h"
+#include "system/smp.h"
 
 static int activeTerminal = -1;
 
 static struct Terminal terminals[NUM_TERMINALS];
 
+// What lockstat shows their read locks as
+static const char* readLockNames[NUM_TERMINALS] = { "tty0", "tty1", "tty2", "tty3" };
+
 void tty_run(char* unused) {
+
+    // This runs as a process, but everything it touches belongs to the kernel
+    smp_enter_kernel();
+
     tty_screen_init();
     tty_keyboard_init();
 
@@ -23,11 +31,20 @@ void tty_run(char* unused) {
     for (int i = 0; i < NUM_TERMINALS; i++) {
         terminals[i].termios.canon = 1;
         terminals[i].termios.echo = 1;
+        terminals[i].termios.time = 0;
+        // Readers wait for this process to hand them their input
+        wait_queue_set_owner(&terminals[i].wait, scheduler_current());
+        mutex_init(&terminals[i].readLock);
+        lock_stats_register(readLockNames[i], &terminals[i].readLock.stats);
         process_table_new(shell, NULL, scheduler_current(), 0, i, 1);
     }
 
+    smp_leave_kernel();
+
     while (1) {
+        smp_enter_kernel();
         process_scancode();
+        smp_leave_kernel();
     }
 }
 
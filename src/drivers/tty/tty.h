@@ -14,6 +14,4 @@ size_t readKeyboard(void* buffer, size_t count);
 
 int ioctlKeyboard(int cmd, void* argp);
 
-void tty_detach_process(struct Process* process);
-
 #endif
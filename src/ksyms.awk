@@ -0,0 +1,29 @@
+# Turns `nm -n` output into the kernel's symbol table, see system/symbols.h
+# Only code symbols are kept. Everything goes in .data, which is linked after
+# the code, so adding the table doesn't move any of the symbols in it.
+BEGIN {
+    count = 0
+}
+
+$2 == "T" || $2 == "t" {
+    addresses[count] = $1
+    names[count] = $3
+    count++
+}
+
+END {
+    print "; Generated by ksyms.awk, do not edit"
+    print "GLOBAL kernelSymbols"
+    print "GLOBAL kernelSymbolCount"
+    print ""
+    print "[SECTION .data]"
+    print "kernelSymbolCount:"
+    print "    dd " count
+    print "kernelSymbols:"
+    for (i = 0; i < count; i++) {
+        print "    dd 0x" addresses[i] ", ksym" i
+    }
+    for (i = 0; i < count; i++) {
+        print "ksym" i ": db \"" names[i] "\", 0"
+    }
+}
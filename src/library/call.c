@@ -1,7 +1,71 @@
 #include "library/call.h"
 
+// CPUID leaf 1 EDX
+#define SEP_FLAG (0x1u << 11)
+
+static int fastPath = -1;
+
+static int has_sysenter(void);
+
+static int fast_system_call(int eax, int ebx, int ecx, int edx);
+
+/**
+ * Whether the kernel took the SYSENTER entry point.
+ *
+ * The kernel sets it up whenever the CPU has it, so we just ask the CPU.
+ */
+int has_sysenter(void) {
+
+    unsigned int eax, ebx, ecx, edx;
+    __asm__ __volatile__ ("cpuid"
+            : "=a" (eax), "=b" (ebx), "=c" (ecx), "=d" (edx)
+            : "0" (1), "2" (0)
+    );
+
+    unsigned int family = (eax >> 8) & 0xF;
+    unsigned int model = (eax >> 4) & 0xF;
+    unsigned int stepping = eax & 0xF;
+
+    // The Pentium Pro says it has SEP, but it doesn't
+    if (family == 6 && model < 3 && stepping < 3) {
+        return 0;
+    }
+
+    return (edx & SEP_FLAG) != 0;
+}
+
+/**
+ * Call into the kernel through SYSENTER.
+ *
+ * The kernel expects our stack in ecx and the return address in edx,
+ * so the arguments that usually go there are moved to esi and edi.
+ */
+int fast_system_call(int eax, int ebx, int ecx, int edx) {
+
+    int ret;
+    __asm__ __volatile__ (
+            "movl %%esp, %%ecx\n\t"
+            "movl $1f, %%edx\n\t"
+            "sysenter\n"
+            "1:"
+            : "=a" (ret)
+            : "0" (eax), "b" (ebx), "S" (ecx), "D" (edx)
+            : "ecx", "edx", "memory", "cc"
+    );
+
+    return ret;
+}
+
 int system_call(int eax, int ebx, int ecx, int edx) {
 
+    if (fastPath == -1) {
+        fastPath = has_sysenter();
+    }
+
+    if (fastPath) {
+        return fast_system_call(eax, ebx, ecx, edx);
+    }
+
     int ret;
     __asm__ __volatile__ ( "int $0x80"
             : "=a" (ret)
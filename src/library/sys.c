@@ -1,6 +1,10 @@
 #include "library/sys.h"
 #include "system/call/codes.h"
 #include "library/call.h"
+#include "library/time.h"
+#include "library/stdlib.h"
+
+static void thread_start(int (*entry)(void*), void* arg);
 
 void yield(void) {
     system_call(_SYS_YIELD, 0, 0, 0);
@@ -10,6 +14,29 @@ pid_t wait(void) {
     return system_call(_SYS_WAIT, 0, 0, 0);
 }
 
+/**
+ * Wait for a child to finish, for at most ms milliseconds.
+ *
+ * @param ms The timeout, 0 waits forever.
+ *
+ * @return The pid of the child, 0 on timeout, -1 if there are no children.
+ */
+pid_t timedwait(unsigned int ms) {
+    return system_call(_SYS_WAIT, ms, 0, 0);
+}
+
+/**
+ * Suspend the calling process for ms milliseconds.
+ *
+ * @param ms The time to sleep.
+ *
+ * @return 0 on success.
+ */
+int sleep(unsigned int ms) {
+    struct timespec req = { .tv_sec = ms / 1000, .tv_nsec = (ms % 1000) * 1000000 };
+    return nanosleep(&req, NULL);
+}
+
 void exit(void) {
     system_call(_SYS_EXIT, 0, 0, 0);
 }
@@ -30,6 +57,211 @@ void kill(pid_t pid) {
     system_call(_SYS_KILL, pid, 0, 0);
 }
 
-int pinfo(struct ProcessInfo* data, size_t size) {
-    return system_call(_SYS_PINFO, data, 20,0);
+/**
+ * Take a snapshot of every process.
+ *
+ * Set header->version to PSNAPSHOT_VERSION before calling. Entries are
+ * header->entrySize bytes apart in buffer.
+ *
+ * @param header The snapshot header.
+ * @param buffer Where to store the entries.
+ * @param length The size of buffer, in bytes.
+ *
+ * @return The number of entries stored, -1 if the version isn't supported.
+ */
+int psnapshot(struct ProcessSnapshotHeader* header, void* buffer, size_t length) {
+    return system_call(_SYS_PSNAPSHOT, (int) header, (int) buffer, length);
+}
+
+/**
+ * Get the usage statistics of every system call.
+ *
+ * @param data Where to store them.
+ * @param size How many entries fit in data.
+ *
+ * @return How many entries were stored.
+ */
+int sysstat(struct SyscallInfo* data, size_t size) {
+    return system_call(_SYS_SYSSTAT, (int) data, size, 0);
+}
+
+/**
+ * Control the sampling profiler.
+ *
+ * @param cmd One of the PROFILE_ commands.
+ * @param buffer Where PROFILE_READ stores the samples.
+ * @param length The size of buffer, in bytes.
+ *
+ * @return Depends on cmd, -1 if it's not known.
+ */
+int profile(int cmd, void* buffer, size_t length) {
+    return system_call(_SYS_PROFILE, cmd, (int) buffer, length);
+}
+
+/**
+ * Find the kernel symbol an address belongs to.
+ *
+ * @param address The address to look up.
+ * @param symbol Where to store the symbol.
+ *
+ * @return 0 on success, -1 if there's no symbol for it.
+ */
+int ksymbol(unsigned int address, struct KernelSymbol* symbol) {
+    return system_call(_SYS_KSYMBOL, address, (int) symbol, 0);
+}
+
+/**
+ * Read the hardware event counters of the calling process.
+ *
+ * @param who PERF_SELF, or PERF_CHILDREN for the children already waited for.
+ * @param data Where to store them.
+ *
+ * @return 0 on success, -1 if who is not known.
+ */
+int perfstat(int who, struct PerfCounters* data) {
+    return system_call(_SYS_PERFSTAT, who, (int) data, 0);
+}
+
+/**
+ * Sleep until futex_wake is called on address, if it still holds value.
+ *
+ * @param address The futex word.
+ * @param value What the caller saw in it.
+ * @param timeout Milliseconds to wait at most, 0 to wait forever.
+ *
+ * @return FUTEX_WOKEN, FUTEX_CHANGED, FUTEX_TIMEDOUT, or -1 on a bad address.
+ */
+int futex_wait(volatile int* address, int value, unsigned int timeout) {
+    return system_call(_SYS_FUTEX_WAIT, (int) address, value, timeout);
+}
+
+/**
+ * Wake up to count processes sleeping on address.
+ *
+ * @return How many were woken up, or -1 on a bad address.
+ */
+int futex_wake(volatile int* address, int count) {
+    return system_call(_SYS_FUTEX_WAKE, (int) address, count, 0);
+}
+
+void thread_start(int (*entry)(void*), void* arg) {
+    thread_exit(entry(arg));
+}
+
+/**
+ * Run entry(arg) in a new thread of the calling process.
+ *
+ * Threads share everything but their stack. Returning from entry is the
+ * same as calling thread_exit with what it returned.
+ *
+ * @return The id of the thread, -1 if it couldn't be created.
+ */
+pid_t thread_create(int (*entry)(void*), void* arg) {
+    return system_call(_SYS_THREAD_CREATE, (int) thread_start, (int) entry, (int) arg);
+}
+
+/**
+ * End the calling thread, or the whole process if it's the main one.
+ *
+ * @param status What thread_join returns for it.
+ */
+void thread_exit(int status) {
+    system_call(_SYS_THREAD_EXIT, status, 0, 0);
+}
+
+/**
+ * Wait for another thread of this process to end.
+ *
+ * @param tid The thread.
+ * @param status Where to store what it passed to thread_exit, can be NULL.
+ *
+ * @return 0 on success, -1 if tid is not another thread of this process.
+ */
+int thread_join(pid_t tid, int* status) {
+    return system_call(_SYS_THREAD_JOIN, tid, (int) status, 0);
+}
+
+/**
+ * Reserve runtime nanoseconds every period for a process, done within deadline.
+ *
+ * Such processes run before any other. Yielding ends the current job, the
+ * next one starts with the next period.
+ *
+ * @param pid The process, 0 for the caller.
+ * @param params The reservation, or NULL to go back to the normal policy.
+ *
+ * @return 0 on success, DEADLINE_INVALID for bad arguments, or
+ *         DEADLINE_REFUSED if the CPU can't take it.
+ */
+int sched_setdeadline(pid_t pid, const struct DeadlineParams* params) {
+    return system_call(_SYS_SCHED_SETDEADLINE, pid, (int) params, 0);
+}
+
+/**
+ * Choose the policy a process is scheduled by.
+ *
+ * @param pid The process, 0 for the caller.
+ * @param policy One of the SCHED_ policies, or SCHED_DEFAULT to follow the system's.
+ *
+ * @return 0 on success, -1 if there's no such process or policy.
+ */
+int sched_setscheduler(pid_t pid, int policy) {
+    return system_call(_SYS_SCHED_SETSCHEDULER, pid, policy, 0);
+}
+
+/**
+ * Change the policy of every process that didn't choose one.
+ *
+ * @param policy One of the SCHED_ policies, or SCHED_DEFAULT to only ask for the current one.
+ *
+ * @return The policy before, or -1 if there's no such policy.
+ */
+int sched_setdefault(int policy) {
+    return system_call(_SYS_SCHED_SETDEFAULT, policy, 0, 0);
+}
+
+/**
+ * Make the caller nicer to the other processes, or less so.
+ *
+ * @param increment Added to its nice value, which stays within NICE_MIN and NICE_MAX.
+ *
+ * @return The nice value it ended up with.
+ */
+int nice(int increment) {
+    return system_call(_SYS_NICE, increment, 0, 0);
+}
+
+/**
+ * Set the nice value of a process.
+ *
+ * @param pid The process, 0 for the caller.
+ * @param nice The value, clamped to NICE_MIN and NICE_MAX.
+ *
+ * @return 0 on success, -1 if there's no such process.
+ */
+int setpriority(pid_t pid, int nice) {
+    return system_call(_SYS_SETPRIORITY, pid, nice, 0);
+}
+
+/**
+ * Find out how the kernel's memory is used.
+ *
+ * @param data Where to write it.
+ *
+ * @return 0 on success, -1 if data is NULL.
+ */
+int memstat(struct MemStats* data) {
+    return system_call(_SYS_MEMSTAT, (int) data, 0, 0);
+}
+
+/**
+ * Find out how much the kernel's locks were used, and how much they were fought over.
+ *
+ * @param data Where to write the info, one entry per lock.
+ * @param size How many entries fit in data.
+ *
+ * @return The number of entries written.
+ */
+int lockstat(struct LockInfo* data, size_t size) {
+    return system_call(_SYS_LOCKSTAT, (int) data, size, 0);
 }
@@ -7,6 +7,10 @@ void yield(void);
 
 pid_t wait(void);
 
+pid_t timedwait(unsigned int ms);
+
+int sleep(unsigned int ms);
+
 void exit(void);
 
 pid_t run(void(*entryPoint)(char*), char* args, int fg);
@@ -17,5 +21,37 @@ pid_t getppid(void);
 
 void kill(pid_t pid);
 
-int pinfo(struct ProcessInfo* data, size_t size);
+int psnapshot(struct ProcessSnapshotHeader* header, void* buffer, size_t length);
+
+int sysstat(struct SyscallInfo* data, size_t size);
+
+int profile(int cmd, void* buffer, size_t length);
+
+int ksymbol(unsigned int address, struct KernelSymbol* symbol);
+
+int perfstat(int who, struct PerfCounters* data);
+
+int futex_wait(volatile int* address, int value, unsigned int timeout);
+
+int futex_wake(volatile int* address, int count);
+
+pid_t thread_create(int (*entry)(void*), void* arg);
+
+void thread_exit(int status);
+
+int thread_join(pid_t tid, int* status);
+
+int sched_setdeadline(pid_t pid, const struct DeadlineParams* params);
+
+int sched_setscheduler(pid_t pid, int policy);
+
+int sched_setdefault(int policy);
+
+int nice(int increment);
+
+int setpriority(pid_t pid, int nice);
+
+int memstat(struct MemStats* data);
+
+int lockstat(struct LockInfo* data, size_t size);
 #endif
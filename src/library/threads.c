@@ -0,0 +1,170 @@
+#include "library/threads.h"
+#include "library/sys.h"
+
+// More than there can ever be waiting
+#define WAKE_ALL 0x7FFFFFFF
+
+void mtx_init(mtx_t* mutex) {
+    mutex->state = 0;
+}
+
+/**
+ * Lock a mutex, sleeping in the kernel only if it's held.
+ *
+ * Taking a free mutex is a single compare and swap. A waiter always
+ * leaves the state at 2, so the unlock that follows knows to wake someone.
+ *
+ * @param mutex The mutex.
+ */
+void mtx_lock(mtx_t* mutex) {
+
+    int state = __sync_val_compare_and_swap(&mutex->state, 0, 1);
+    if (state == 0) {
+        return;
+    }
+
+    if (state != 2) {
+        state = __sync_lock_test_and_set(&mutex->state, 2);
+    }
+
+    while (state != 0) {
+        futex_wait(&mutex->state, 2, 0);
+        state = __sync_lock_test_and_set(&mutex->state, 2);
+    }
+}
+
+/**
+ * Lock a mutex, if it's free.
+ *
+ * @param mutex The mutex.
+ *
+ * @return 1 if it was locked, 0 otherwise.
+ */
+int mtx_trylock(mtx_t* mutex) {
+    return __sync_bool_compare_and_swap(&mutex->state, 0, 1);
+}
+
+/**
+ * Unlock a mutex, entering the kernel only if someone might be waiting.
+ *
+ * @param mutex The mutex.
+ */
+void mtx_unlock(mtx_t* mutex) {
+
+    if (__sync_fetch_and_sub(&mutex->state, 1) != 1) {
+        mutex->state = 0;
+        futex_wake(&mutex->state, 1);
+    }
+}
+
+void cnd_init(cnd_t* cond) {
+    cond->sequence = 0;
+    cond->waiters = 0;
+}
+
+/**
+ * Unlock mutex, and sleep until the condition is signaled.
+ *
+ * The mutex is locked again before returning. Wakeups can be spurious,
+ * so callers check their condition in a loop.
+ *
+ * @param cond The condition.
+ * @param mutex The mutex the caller holds.
+ */
+void cnd_wait(cnd_t* cond, mtx_t* mutex) {
+    cnd_timedwait(cond, mutex, 0);
+}
+
+/**
+ * Same as cnd_wait, but give up after ms milliseconds.
+ *
+ * @return 0 if it was woken up, -1 if it timed out.
+ */
+int cnd_timedwait(cnd_t* cond, mtx_t* mutex, unsigned int ms) {
+
+    // Registered before the sequence is read, see cnd_signal
+    __sync_fetch_and_add(&cond->waiters, 1);
+    int sequence = cond->sequence;
+
+    mtx_unlock(mutex);
+    int res = futex_wait(&cond->sequence, sequence, ms);
+    __sync_fetch_and_sub(&cond->waiters, 1);
+    mtx_lock(mutex);
+
+    return res == FUTEX_TIMEDOUT ? -1 : 0;
+}
+
+/**
+ * Wake up one waiter, if there's any.
+ *
+ * The sequence is bumped before waiters is read. A waiter does it the other
+ * way around, so either it sees the new sequence, or this sees the waiter.
+ *
+ * @param cond The condition.
+ */
+void cnd_signal(cnd_t* cond) {
+
+    __sync_fetch_and_add(&cond->sequence, 1);
+    if (cond->waiters) {
+        futex_wake(&cond->sequence, 1);
+    }
+}
+
+void cnd_broadcast(cnd_t* cond) {
+
+    __sync_fetch_and_add(&cond->sequence, 1);
+    if (cond->waiters) {
+        futex_wake(&cond->sequence, WAKE_ALL);
+    }
+}
+
+void sem_init(sem_t* sem, int count) {
+    sem->count = count;
+    sem->waiters = 0;
+}
+
+/**
+ * Take a unit, sleeping in the kernel only while there are none left.
+ *
+ * @param sem The semaphore.
+ */
+void sem_wait(sem_t* sem) {
+
+    while (!sem_trywait(sem)) {
+        __sync_fetch_and_add(&sem->waiters, 1);
+        futex_wait(&sem->count, 0, 0);
+        __sync_fetch_and_sub(&sem->waiters, 1);
+    }
+}
+
+/**
+ * Take a unit, if there's one left.
+ *
+ * @param sem The semaphore.
+ *
+ * @return 1 if it was taken, 0 otherwise.
+ */
+int sem_trywait(sem_t* sem) {
+
+    int count;
+    while ((count = sem->count) > 0) {
+        if (__sync_bool_compare_and_swap(&sem->count, count, count - 1)) {
+            return 1;
+        }
+    }
+
+    return 0;
+}
+
+/**
+ * Give back a unit, waking up a waiter if there's any.
+ *
+ * @param sem The semaphore.
+ */
+void sem_post(sem_t* sem) {
+
+    __sync_fetch_and_add(&sem->count, 1);
+    if (sem->waiters) {
+        futex_wake(&sem->count, 1);
+    }
+}
@@ -0,0 +1,53 @@
+#ifndef __LIBRARY_THREADS__
+#define __LIBRARY_THREADS__
+
+#include "type.h"
+
+/**
+ * 0 when unlocked, 1 when locked, 2 when locked and someone might be waiting.
+ */
+typedef struct {
+    volatile int state;
+} mtx_t;
+
+typedef struct {
+    // Bumped on every signal, waiters sleep on it
+    volatile int sequence;
+    volatile int waiters;
+} cnd_t;
+
+typedef struct {
+    volatile int count;
+    volatile int waiters;
+} sem_t;
+
+#define MTX_INITIALIZER { 0 }
+#define CND_INITIALIZER { 0, 0 }
+
+void mtx_init(mtx_t* mutex);
+
+void mtx_lock(mtx_t* mutex);
+
+int mtx_trylock(mtx_t* mutex);
+
+void mtx_unlock(mtx_t* mutex);
+
+void cnd_init(cnd_t* cond);
+
+void cnd_wait(cnd_t* cond, mtx_t* mutex);
+
+int cnd_timedwait(cnd_t* cond, mtx_t* mutex, unsigned int ms);
+
+void cnd_signal(cnd_t* cond);
+
+void cnd_broadcast(cnd_t* cond);
+
+void sem_init(sem_t* sem, int count);
+
+void sem_wait(sem_t* sem);
+
+int sem_trywait(sem_t* sem);
+
+void sem_post(sem_t* sem);
+
+#endif
@@ -28,6 +28,29 @@ time_t time(time_t *tp) {
     return system_call(_SYS_TIME,tp,0,0);
 }
 
+/**
+ * Get the time of the given clock, with nanosecond resolution.
+ *
+ * @param clock Either CLOCK_REALTIME or CLOCK_MONOTONIC.
+ * @param tp Pointer to the timespec where the time is stored.
+ *
+ * @return 0 on success, -1 if the clock is not known.
+ */
+int clock_gettime(int clock, struct timespec* tp) {
+    return system_call(_SYS_CLOCK_GETTIME, clock, (int) tp, 0);
+}
+
+/**
+ * Suspend the calling process for at least the time in req.
+ *
+ * @param req How long to sleep.
+ * @param rem If not NULL, where the unslept time is stored.
+ *
+ * @return 0 on success, -1 if req is not valid.
+ */
+int nanosleep(const struct timespec* req, struct timespec* rem) {
+    return system_call(_SYS_NANOSLEEP, (int) req, (int) rem, 0);
+}
 
 /**
  * Returns a the local time in a human-readable formtat.
@@ -15,8 +15,15 @@ struct tm {
     int isdst;
 };
 
+#define CLOCK_REALTIME 0
+#define CLOCK_MONOTONIC 1
+
 time_t time(time_t *tp);
 
+int clock_gettime(int clock, struct timespec* tp);
+
+int nanosleep(const struct timespec* req, struct timespec* rem);
+
 char* asctime(const struct tm *tp);
 
 struct tm* localtime(const time_t* timer);
@@ -0,0 +1,94 @@
+#include "shell/burn/burn.h"
+#include "library/stdio.h"
+#include "library/string.h"
+#include "library/stdlib.h"
+#include "library/sys.h"
+#include "library/time.h"
+#include "mcurses/mcurses.h"
+#include "type.h"
+
+#define DEFAULT_WORKERS 4
+#define MAX_WORKERS 16
+
+// Each worker's share, about a second on a 1 GHz CPU
+#define WORK_ITERATIONS 200000000u
+
+static void worker(char* unused);
+
+static unsigned int elapsed(int workers);
+
+/**
+ * A process that only uses the CPU, for as long as WORK_ITERATIONS takes.
+ */
+void worker(char* unused) {
+
+    (void) unused;
+
+    for (volatile unsigned int i = 0; i < WORK_ITERATIONS; i++);
+}
+
+/**
+ * Run workers in parallel, and wait for all of them.
+ *
+ * @return The milliseconds it took.
+ */
+unsigned int elapsed(int workers) {
+
+    struct timespec start, end;
+    clock_gettime(CLOCK_MONOTONIC, &start);
+
+    for (int i = 0; i < workers; i++) {
+        run(worker, NULL, 0);
+    }
+    for (int i = 0; i < workers; i++) {
+        wait();
+    }
+
+    clock_gettime(CLOCK_MONOTONIC, &end);
+
+    return (end.tv_sec - start.tv_sec) * 1000 + (end.tv_nsec - start.tv_nsec) / 1000000;
+}
+
+/**
+ * Command that checks how CPU-bound work scales with the CPUs there are.
+ *
+ * The same work is done by one worker, and then by as many as asked at
+ * once. On a single CPU they take as many times longer, with one CPU per
+ * worker they take the same.
+ *
+ * @param argv A string containg everything that came after the command.
+ */
+void burnCmd(char* argv) {
+
+    int workers = DEFAULT_WORKERS;
+
+    char* arg = strchr(argv, ' ');
+    if (arg != NULL) {
+        workers = atoi(arg + 1);
+        if (workers < 1 || workers > MAX_WORKERS) {
+            manBurn();
+            return;
+        }
+    }
+
+    unsigned int one = elapsed(1);
+    unsigned int all = elapsed(workers);
+
+    printf("1 worker: %u ms\n", one);
+    printf("%d workers: %u ms\n", workers, all);
+    if (all) {
+        // How many CPUs did the work, in hundredths
+        printf("Speedup: %u%%\n", workers * one * 100 / all);
+    }
+}
+
+void manBurn(void) {
+    setBold(1);
+    printf("Usage:\n\tburn");
+    setBold(0);
+    printf(" [workers]\n\n");
+
+    printf("\tRuns a CPU-bound worker on its own, and then that many of them at\n");
+    printf("\tonce, %d by default and %d at most. Shows how long each took, and\n", DEFAULT_WORKERS, MAX_WORKERS);
+    printf("\tthe speedup, which is about 100%% times the CPUs the workers got.\n");
+}
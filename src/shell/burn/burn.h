@@ -0,0 +1,8 @@
+#ifndef __SHELL_BURN__
+#define __SHELL_BURN__
+
+void burnCmd(char* argv);
+
+void manBurn(void);
+
+#endif
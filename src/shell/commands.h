@@ -11,5 +11,15 @@
 #include "shell/date/date.h"
 #include "shell/kill/kill.h"
 #include "shell/top/top.h"
+#include "shell/sysstat/sysstat.h"
+#include "shell/prof/prof.h"
+#include "shell/perfstat/perfstat.h"
+#include "shell/sched/sched.h"
+#include "shell/nice/nice.h"
+#include "shell/memstat/memstat.h"
+#include "shell/lockstat/lockstat.h"
+#include "shell/burn/burn.h"
+#include "shell/inherit/inherit.h"
+#include "shell/threads/threads.h"
 
 #endif
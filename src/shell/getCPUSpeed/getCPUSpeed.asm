@@ -2,13 +2,13 @@ GLOBAL  getCPUSpeedHandler
 
 getCPUSpeedHandler:
     ;wait until the timer interrupt has been called.
-    mov eax, 191    ; Calling the ticks syscall 
+    mov eax, 4      ; Calling the ticks syscall (_SYS_TICKS) 
     int 80h 
 	
     mov  ebx, eax
 
 waitIrq0:
-    mov eax, 191    ; Calling the ticks syscall 
+    mov eax, 4      ; Calling the ticks syscall (_SYS_TICKS) 
     int 80h 
 	
     cmp  ebx, eax
@@ -23,7 +23,7 @@ waitIrq0:
 	add  ebx, 2
 
 waitForElapsedTicks:
-    mov eax, 191    ;Calling the ticks syscall 
+    mov eax, 4      ; Calling the ticks syscall (_SYS_TICKS) 
     int 80h 
     
     ; Have we reached the number of ticks we previously set? 
@@ -35,12 +35,7 @@ waitForElapsedTicks:
     sub eax, [timeStampCounterLow] 
    	sbb edx, [timeStampCounterHigh]
 
-   	; microSeconds  =  ( numberOfTicks / totalTicksPerSecond) * 1,000,000
-	; so for this: microSeconds = (1/18.2) * 1,000,000 = 54945
-	mov ebx, 54945
-	div ebx
-
-	; eax contains measured speed in MHz
+	; edx:eax contains the clock cycles in 2 ticks, the caller knows how long that is
     ret 
 
 [SECTION .data]
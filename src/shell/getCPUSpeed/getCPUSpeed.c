@@ -1,10 +1,15 @@
 #include "shell/getCPUSpeed/getCPUSpeed.h"
 #include "library/stdio.h"
 #include "mcurses/mcurses.h"
+#include "library/div64.h"
+#include "system/timer.h"
 
 #define MEASURES_NUMBER		6
 
-int getCPUSpeedHandler(void);
+// The handler measures over 2 ticks
+#define MEASURE_MICROSECONDS    (2 * 1000000 / HZ)
+
+unsigned long long getCPUSpeedHandler(void);
 
 /**
  * Command that returns the CPU speed.
@@ -17,7 +22,7 @@ int getCPUSpeedHandler(void);
 void getCPUSpeed(char* argv) {
     int i, acumMeasure = 0;
     for (i = 0; i < MEASURES_NUMBER;i++) {
-	acumMeasure += getCPUSpeedHandler();
+	acumMeasure += uint64_div64(getCPUSpeedHandler(), MEASURE_MICROSECONDS);
     }
     printf("The measured CPU Speed is: %d Mhz\n",acumMeasure / MEASURES_NUMBER);
 }
@@ -0,0 +1,118 @@
+#include "shell/inherit/inherit.h"
+#include "library/stdio.h"
+#include "library/stdlib.h"
+#include "library/sys.h"
+#include "mcurses/mcurses.h"
+#include "type.h"
+
+// Long enough for a process that was just started to block
+#define SETTLE_MS 100
+
+// Where find starts, it grows to whatever the kernel says there is
+#define FIRST_CAPACITY 16
+
+static void reader(char* unused);
+
+static int find(pid_t pid, struct ProcessSnapshot* found);
+
+/**
+ * A process that reads a line, holding its terminal's read lock until it gets one.
+ */
+void reader(char* unused) {
+
+    (void) unused;
+
+    getchar();
+}
+
+/**
+ * Look a process up in a snapshot of all of them.
+ *
+ * @return 0 if it was there, -1 otherwise.
+ */
+int find(pid_t pid, struct ProcessSnapshot* found) {
+
+    struct ProcessSnapshotHeader header;
+    size_t capacity = FIRST_CAPACITY;
+
+    while (1) {
+
+        struct ProcessSnapshot data[capacity];
+
+        header.version = PSNAPSHOT_VERSION;
+        int count = psnapshot(&header, data, sizeof(data));
+        if (count < 0) {
+            return -1;
+        }
+
+        if ((size_t) count < header.total) {
+            capacity = header.total;
+            continue;
+        }
+
+        for (int i = 0; i < count; i++) {
+            if (data[i].pid == pid) {
+                *found = data[i];
+                return 0;
+            }
+        }
+
+        return -1;
+    }
+}
+
+/**
+ * Command that checks a lock holder runs at the priority of who waits for it.
+ *
+ * A reader at the lowest priority takes the terminal's read lock, and
+ * sleeps waiting for a line while it holds it. Then a reader at the
+ * highest priority waits for the lock. The first one has to be running at
+ * the second one's priority, and go back to its own once it's gone.
+ *
+ * @param argv A string containg everything that came after the command.
+ */
+void inheritCmd(char* argv) {
+
+    (void) argv;
+
+    struct ProcessSnapshot holder = { 0 }, waiter = { 0 };
+
+    // Round robin doesn't look at priorities, so they don't follow it
+    pid_t low = run(reader, NULL, 1);
+    setpriority(low, NICE_MAX);
+    sched_setscheduler(low, SCHED_PRIORITY);
+    sleep(SETTLE_MS);
+
+    pid_t high = run(reader, NULL, 1);
+    setpriority(high, NICE_MIN);
+    sched_setscheduler(high, SCHED_PRIORITY);
+    sleep(SETTLE_MS);
+
+    int boosted = find(low, &holder) == 0 && find(high, &waiter) == 0 &&
+        holder.priority == waiter.priority && holder.priority > NICE_MAX - holder.nice;
+
+    printf("Holder: nice %d, priority %d\n", holder.nice, holder.priority);
+    printf("Waiter: nice %d, priority %d\n", waiter.nice, waiter.priority);
+
+    kill(high);
+    wait();
+
+    int restored = find(low, &holder) == 0 && holder.priority == NICE_MAX - holder.nice;
+    printf("Holder after the waiter is gone: priority %d\n", holder.priority);
+
+    kill(low);
+    wait();
+
+    printf("%s\n", boosted && restored ? "PASS" : "FAIL");
+}
+
+void manInherit(void) {
+    setBold(1);
+    printf("Usage:\n\t inherit\n");
+    setBold(0);
+
+    printf("\n\tChecks that a process holding a lock runs at the priority of the\n");
+    printf("\tmost urgent process waiting for it, and drops back to its own when\n");
+    printf("\tthat one goes away. Two readers of this terminal take turns on its\n");
+    printf("\tread lock, so don't type anything while it runs.\n");
+}
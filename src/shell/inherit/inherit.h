@@ -0,0 +1,8 @@
+#ifndef __SHELL_INHERIT__
+#define __SHELL_INHERIT__
+
+void inheritCmd(char* argv);
+
+void manInherit(void);
+
+#endif
@@ -0,0 +1,42 @@
+#include "shell/lockstat/lockstat.h"
+#include "library/stdio.h"
+#include "library/sys.h"
+#include "library/div64.h"
+#include "mcurses/mcurses.h"
+#include "type.h"
+
+#define MAX_LOCKS 16
+
+/**
+ * Command that shows how often each kernel lock was taken, and how long it was waited for.
+ *
+ * @param argv A string containg everything that came after the command.
+ */
+void lockstatCmd(char* argv) {
+
+    (void) argv;
+
+    struct LockInfo data[MAX_LOCKS];
+    int count = lockstat(data, MAX_LOCKS);
+
+    printf("NAME\t\tTAKEN\tCONTENDED\tWAIT (Mcycles)\n");
+
+    for (int i = 0; i < count; i++) {
+        printf("%s\t\t", data[i].name);
+        printf("%u\t", data[i].acquired);
+        printf("%u\t\t", data[i].contended);
+        printf("%u\n", (unsigned int) uint64_div64(data[i].waitCycles, 1000000u));
+    }
+}
+
+/**
+ * Print manual page for the lockstat command.
+ */
+void manLockstat(void) {
+    setBold(1);
+    printf("Usage:\n\t lockstat\n");
+    setBold(0);
+
+    printf("\n\tShows how many times each kernel lock was taken, how many of those\n");
+    printf("\tit was already held, and the millions of cycles spent waiting for it.\n");
+}
@@ -0,0 +1,8 @@
+#ifndef __SHELL_LOCKSTAT__
+#define __SHELL_LOCKSTAT__
+
+void lockstatCmd(char* argv);
+
+void manLockstat(void);
+
+#endif
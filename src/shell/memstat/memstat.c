@@ -0,0 +1,50 @@
+#include "shell/memstat/memstat.h"
+#include "library/stdio.h"
+#include "library/sys.h"
+#include "mcurses/mcurses.h"
+#include "type.h"
+
+/**
+ * Command that shows how the kernel's memory is used.
+ *
+ * @param argv A string containg everything that came after the command.
+ */
+void memstatCmd(char* argv) {
+
+    (void) argv;
+
+    struct MemStats data;
+    memstat(&data);
+
+    printf("SIZE\tPERSLAB\tSLABS\tACTIVE\tALLOCS\tFREES\n");
+
+    for (size_t i = 0; i < data.caches; i++) {
+
+        struct SlabCacheStats* cache = &data.cache[i];
+
+        printf("%u\t", cache->objectSize);
+        printf("%u\t", cache->objectsPerSlab);
+        printf("%u\t", cache->slabs);
+        printf("%u\t", cache->active);
+        printf("%u\t", cache->allocs);
+        printf("%u\n", cache->frees);
+    }
+
+    printf("\nMapped: %u large pages (%u K), %u small pages (%u K)\n",
+            data.paging.largePages, data.paging.largePages * 4096,
+            data.paging.smallPages, data.paging.smallPages * 4);
+}
+
+/**
+ * Print manual page for the memstat command.
+ */
+void manMemstat(void) {
+    setBold(1);
+    printf("Usage:\n\t memstat\n");
+    setBold(0);
+
+    printf("\n\tShows every kmalloc size class: the size of its objects, how many\n");
+    printf("\tfit in a slab, the slabs it has, the objects in use, and how many\n");
+    printf("\tallocations and frees it served. Then how much memory is mapped\n");
+    printf("\twith 4 MiB pages, and with 4 KiB pages across every address space.\n");
+}
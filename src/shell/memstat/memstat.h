@@ -0,0 +1,8 @@
+#ifndef __SHELL_MEMSTAT__
+#define __SHELL_MEMSTAT__
+
+void memstatCmd(char* argv);
+
+void manMemstat(void);
+
+#endif
@@ -0,0 +1,51 @@
+#include "shell/nice/nice.h"
+#include "library/stdio.h"
+#include "library/string.h"
+#include "library/stdlib.h"
+#include "library/ctype.h"
+#include "library/sys.h"
+#include "mcurses/mcurses.h"
+#include "type.h"
+
+/**
+ * Command that shows or changes the nice value, of the shell or of a process.
+ *
+ * The shell's is what the commands it runs start with.
+ *
+ * @param argv A string containg everything that came after the command.
+ */
+void niceCmd(char* argv) {
+
+    char* value = strchr(argv, ' ');
+    if (value == NULL) {
+        // Commands start as nice as the shell
+        printf("Nice value: %d\n", nice(0));
+        return;
+    }
+    value++;
+
+    if (!isdigit(*value) && !(*value == '-' && isdigit(value[1]))) {
+        manNice();
+        return;
+    }
+
+    char* pidArg = strchr(value, ' ');
+    pid_t pid = pidArg ? atoi(pidArg) : getppid();
+
+    if (pid == 0 || setpriority(pid, atoi(value)) != 0) {
+        printf("nice: no such process\n");
+    }
+}
+
+void manNice(void) {
+    setBold(1);
+    printf("Usage:\n\tnice");
+    setBold(0);
+    printf(" [value [pid]]\n\n");
+
+    printf("\tWithout arguments, shows the nice value commands start with.\n");
+    printf("\tWith a value, changes it for the shell, and every command it runs\n");
+    printf("\tfrom then on. With a pid too, only that process is changed.\n\n");
+
+    printf("\tValues go from %d to %d, the lower the more CPU time a process gets.\n", NICE_MIN, NICE_MAX);
+}
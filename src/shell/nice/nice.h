@@ -0,0 +1,8 @@
+#ifndef __SHELL_NICE__
+#define __SHELL_NICE__
+
+void niceCmd(char* argv);
+
+void manNice(void);
+
+#endif
@@ -0,0 +1,109 @@
+#include "shell/perfstat/perfstat.h"
+#include "shell/info.h"
+#include "library/stdio.h"
+#include "library/string.h"
+#include "library/stdlib.h"
+#include "library/sys.h"
+#include "library/div64.h"
+#include "mcurses/mcurses.h"
+#include "type.h"
+
+static const char* eventNames[PERF_EVENTS] = {
+    "cycles", "instructions", "cache-misses", "branch-misses"
+};
+
+static const Command* findCommand(const char* name);
+
+static void printCount(unsigned long long count);
+
+const Command* findCommand(const char* name) {
+
+    size_t len, numCommands;
+    const Command* commands = getShellCommands(&numCommands);
+
+    const char* end = strchr(name, ' ');
+    len = end ? (size_t) (end - name) : strlen(name);
+
+    for (size_t i = 0; i < numCommands; i++) {
+        if (strlen(commands[i].name) == len && strncmp(commands[i].name, name, len) == 0) {
+            return &commands[i];
+        }
+    }
+
+    return NULL;
+}
+
+/**
+ * Print a counter, in millions once it doesn't fit in an int.
+ *
+ * @param count The counter.
+ */
+void printCount(unsigned long long count) {
+
+    if (count < 1000000000u) {
+        printf("%u\t\t", (unsigned int) count);
+    } else {
+        printf("%uM\t\t", (unsigned int) uint64_div64(count, 1000000u));
+    }
+}
+
+/**
+ * Command that runs another one, and shows the hardware events it caused.
+ *
+ * @param argv A string containg everything that came after the command.
+ */
+void perfstatCmd(char* argv) {
+
+    char* firstSpace = strchr(argv, ' ');
+    const Command* cmd = firstSpace ? findCommand(firstSpace + 1) : NULL;
+
+    if (cmd == NULL) {
+        manPerfstat();
+        return;
+    }
+
+    struct PerfCounters before, after;
+    perfstat(PERF_CHILDREN, &before);
+
+    pid_t child = run(cmd->func, firstSpace + 1, 1);
+    if (child == -1) {
+        printf("perfstat: could not run %s\n", cmd->name);
+        return;
+    }
+    while (child != wait());
+
+    perfstat(PERF_CHILDREN, &after);
+
+    printf("\nCounters for '%s':\n\n", firstSpace + 1);
+
+    unsigned long long counts[PERF_EVENTS];
+    for (int i = 0; i < PERF_EVENTS; i++) {
+
+        counts[i] = after.counts[i] - before.counts[i];
+
+        if (after.available & (1u << i)) {
+            printCount(counts[i]);
+        } else {
+            printf("<not counted>\t");
+        }
+        printf("%s\n", eventNames[i]);
+    }
+
+    if ((after.available & (1u << PERF_INSTRUCTIONS)) && counts[PERF_CYCLES]) {
+        unsigned int ipc = uint64_div64(counts[PERF_INSTRUCTIONS] * 100, counts[PERF_CYCLES]);
+        printf("\n%u.%u%u instructions per cycle\n", ipc / 100, (ipc / 10) % 10, ipc % 10);
+    }
+}
+
+/**
+ * Print manual page for the perfstat command.
+ */
+void manPerfstat(void) {
+    setBold(1);
+    printf("Usage:\n\tperfstat");
+    setBold(0);
+
+    printf(" command [args]\n\n");
+    printf("Runs command, and shows the cycles, instructions, cache misses and branch\n");
+    printf("misses it caused. Events the CPU can't count are shown as not counted.\n");
+}
@@ -0,0 +1,8 @@
+#ifndef _shell_perfstat_header_
+#define _shell_perfstat_header_
+
+void perfstatCmd(char* argv);
+
+void manPerfstat(void);
+
+#endif
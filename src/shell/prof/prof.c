@@ -0,0 +1,196 @@
+#include "shell/prof/prof.h"
+#include "library/stdio.h"
+#include "library/string.h"
+#include "library/stdlib.h"
+#include "library/sys.h"
+#include "mcurses/mcurses.h"
+#include "type.h"
+
+// Samples moved out of the kernel at a time
+#define CHUNK 256
+
+// Distinct functions and processes kept in the histograms
+#define MAX_SYMBOLS 128
+#define MAX_PIDS 32
+#define MAX_CPUS 8
+
+// Rows shown in the report
+#define TOP_SYMBOLS 20
+
+struct SymbolCount {
+    struct KernelSymbol symbol;
+    size_t samples;
+};
+
+struct PidCount {
+    pid_t pid;
+    size_t samples;
+};
+
+struct Histogram {
+    struct SymbolCount symbols[MAX_SYMBOLS];
+    size_t symbolCount;
+    struct PidCount pids[MAX_PIDS];
+    size_t pidCount;
+    size_t cpus[MAX_CPUS];
+    // Samples that didn't fit in the tables, or didn't land on a symbol
+    size_t otherSymbols;
+    size_t otherPids;
+    size_t total;
+};
+
+static struct Histogram histogram;
+
+static void addSample(struct Histogram* h, const struct ProfileSample* sample);
+
+static void sortSymbols(struct Histogram* h);
+
+static void report(void);
+
+/**
+ * Count a sample against the function it landed on, and the process that was running.
+ *
+ * @param h The histogram.
+ * @param sample The sample.
+ */
+void addSample(struct Histogram* h, const struct ProfileSample* sample) {
+
+    size_t i;
+
+    h->total++;
+
+    if (sample->cpu < MAX_CPUS) {
+        h->cpus[sample->cpu]++;
+    }
+
+    for (i = 0; i < h->pidCount && h->pids[i].pid != sample->pid; i++);
+    if (i < h->pidCount) {
+        h->pids[i].samples++;
+    } else if (h->pidCount < MAX_PIDS) {
+        h->pids[h->pidCount].pid = sample->pid;
+        h->pids[h->pidCount].samples = 1;
+        h->pidCount++;
+    } else {
+        h->otherPids++;
+    }
+
+    // Most samples land on a function that was already seen, so look there first
+    for (i = 0; i < h->symbolCount; i++) {
+        const struct KernelSymbol* symbol = &h->symbols[i].symbol;
+        if (sample->eip >= symbol->address &&
+            (symbol->size == 0 || sample->eip - symbol->address < symbol->size)) {
+            h->symbols[i].samples++;
+            return;
+        }
+    }
+
+    if (h->symbolCount == MAX_SYMBOLS ||
+        ksymbol(sample->eip, &h->symbols[h->symbolCount].symbol) == -1) {
+        h->otherSymbols++;
+        return;
+    }
+
+    h->symbols[h->symbolCount].samples = 1;
+    h->symbolCount++;
+}
+
+void sortSymbols(struct Histogram* h) {
+
+    for (size_t i = 1; i < h->symbolCount; i++) {
+        struct SymbolCount current = h->symbols[i];
+        size_t j = i;
+        while (j > 0 && h->symbols[j - 1].samples < current.samples) {
+            h->symbols[j] = h->symbols[j - 1];
+            j--;
+        }
+        h->symbols[j] = current;
+    }
+}
+
+/**
+ * Drain the kernel's samples, and print where they landed.
+ */
+void report(void) {
+
+    struct ProfileSample samples[CHUNK];
+    int count;
+
+    memset(&histogram, 0, sizeof(histogram));
+
+    while ((count = profile(PROFILE_READ, samples, sizeof(samples))) > 0) {
+        for (int i = 0; i < count; i++) {
+            addSample(&histogram, &samples[i]);
+        }
+    }
+
+    if (histogram.total == 0) {
+        printf("No samples, run prof start first.\n");
+        return;
+    }
+
+    sortSymbols(&histogram);
+
+    printf("%u samples, %u dropped\n\n", histogram.total, profile(PROFILE_DROPPED, NULL, 0));
+
+    printf("SAMPLES\t%%\tFUNCTION\n");
+    for (size_t i = 0; i < histogram.symbolCount && i < TOP_SYMBOLS; i++) {
+        printf("%u\t%u\t%s\n", histogram.symbols[i].samples,
+                histogram.symbols[i].samples * 100 / histogram.total,
+                histogram.symbols[i].symbol.name);
+    }
+    if (histogram.otherSymbols) {
+        printf("%u\t%u\t[unknown]\n", histogram.otherSymbols,
+                histogram.otherSymbols * 100 / histogram.total);
+    }
+
+    printf("\nSAMPLES\t%%\tPID\n");
+    for (size_t i = 0; i < histogram.pidCount; i++) {
+        printf("%u\t%u\t%d\n", histogram.pids[i].samples,
+                histogram.pids[i].samples * 100 / histogram.total, histogram.pids[i].pid);
+    }
+    if (histogram.otherPids) {
+        printf("%u\t%u\t[other]\n", histogram.otherPids,
+                histogram.otherPids * 100 / histogram.total);
+    }
+
+    printf("\nSAMPLES\t%%\tCPU\n");
+    for (int i = 0; i < MAX_CPUS; i++) {
+        if (histogram.cpus[i]) {
+            printf("%u\t%u\t%d\n", histogram.cpus[i], histogram.cpus[i] * 100 / histogram.total, i);
+        }
+    }
+}
+
+/**
+ * Command that samples where the CPU goes, and reports it by function and process.
+ *
+ * @param argv A string containg everything that came after the command.
+ */
+void prof(char* argv) {
+
+    char* firstSpace = strchr(argv, ' ');
+    const char* action = firstSpace ? firstSpace + 1 : "";
+
+    if (strcmp(action, "start") == 0) {
+        profile(PROFILE_START, NULL, 0);
+    } else if (strcmp(action, "stop") == 0) {
+        profile(PROFILE_STOP, NULL, 0);
+    } else if (strcmp(action, "report") == 0) {
+        report();
+    } else {
+        manProf();
+    }
+}
+
+/**
+ * Print manual page for the prof command.
+ */
+void manProf(void) {
+    setBold(1);
+    printf("Usage:\n\tprof");
+    setBold(0);
+
+    printf(" start|stop|report\n\n");
+    printf("Samples the running code on every timer interrupt. report drains the samples\n");
+    printf("taken so far, and shows them by kernel function, by process and by CPU.\n");
+}
@@ -0,0 +1,8 @@
+#ifndef _shell_prof_header_
+#define _shell_prof_header_
+
+void prof(char* argv);
+
+void manProf(void);
+
+#endif
@@ -0,0 +1,86 @@
+#include "shell/sched/sched.h"
+#include "library/stdio.h"
+#include "library/string.h"
+#include "library/stdlib.h"
+#include "library/sys.h"
+#include "mcurses/mcurses.h"
+#include "type.h"
+
+// Indexed by the SCHED_ constants
+static const char* policyNames[SCHED_POLICIES] = {
+    "roundrobin", "priority", "multilevel", "fair"
+};
+
+static int findPolicy(const char* name, size_t len);
+
+/**
+ * Look up a policy by name.
+ *
+ * @return Its SCHED_ constant, SCHED_DEFAULT for "default", or SCHED_POLICIES if there's no such policy.
+ */
+int findPolicy(const char* name, size_t len) {
+
+    if (len == strlen("default") && strncmp(name, "default", len) == 0) {
+        return SCHED_DEFAULT;
+    }
+
+    for (int i = 0; i < SCHED_POLICIES; i++) {
+        if (strlen(policyNames[i]) == len && strncmp(policyNames[i], name, len) == 0) {
+            return i;
+        }
+    }
+
+    return SCHED_POLICIES;
+}
+
+/**
+ * Command that shows or changes the scheduling policy, of the system or of a process.
+ *
+ * @param argv A string containg everything that came after the command.
+ */
+void schedCmd(char* argv) {
+
+    char* name = strchr(argv, ' ');
+    if (name == NULL) {
+        printf("Default policy: %s\n", policyNames[sched_setdefault(SCHED_DEFAULT)]);
+        return;
+    }
+    name++;
+
+    char* pidArg = strchr(name, ' ');
+    int policy = findPolicy(name, pidArg ? (size_t) (pidArg - name) : strlen(name));
+
+    if (policy == SCHED_POLICIES || (policy == SCHED_DEFAULT && pidArg == NULL)) {
+        manSched();
+        return;
+    }
+
+    if (pidArg == NULL) {
+        int previous = sched_setdefault(policy);
+        printf("Default policy: %s, was %s\n", policyNames[policy], policyNames[previous]);
+        return;
+    }
+
+    pid_t pid = atoi(pidArg);
+    if (pid == 0 || sched_setscheduler(pid, policy) != 0) {
+        printf("sched: no such process\n");
+    }
+}
+
+void manSched(void) {
+    setBold(1);
+    printf("Usage:\n\tsched");
+    setBold(0);
+    printf(" [policy [pid]]\n\n");
+
+    printf("\tWithout arguments, shows the policy processes follow by default.\n");
+    printf("\tWith a policy, makes it the default, and moves over every process\n");
+    printf("\tthat follows it. With a pid too, only that process is moved, and\n");
+    printf("\t'default' makes it follow the default again.\n\n");
+
+    printf("\tPolicies:");
+    for (int i = 0; i < SCHED_POLICIES; i++) {
+        printf(" %s", policyNames[i]);
+    }
+    printf("\n");
+}
@@ -0,0 +1,8 @@
+#ifndef __SHELL_SCHED__
+#define __SHELL_SCHED__
+
+void schedCmd(char* argv);
+
+void manSched(void);
+
+#endif
@@ -12,7 +12,7 @@
 #define BUFFER_SIZE 500
 #define HISTORY_SIZE 50
 
-#define NUM_COMMANDS 10
+#define NUM_COMMANDS 20
 
 struct History {
     char input[HISTORY_SIZE][BUFFER_SIZE];
@@ -62,10 +62,20 @@ const Command commands[] = {
     { &fortune, "fortune", "Receive awesome knowledge.", &manFortune},
     { &date, "date", "Display current date.", &manDate},
     { &killCmd, "kill", "Kill a running process.", &manKill},
-    { &top, "top", "Display information about running processes.", &manTop}
+    { &top, "top", "Display information about running processes.", &manTop},
+    { &sysstatCmd, "sysstat", "Display system call statistics.", &manSysstat},
+    { &prof, "prof", "Profile where the CPU time goes.", &manProf},
+    { &perfstatCmd, "perfstat", "Count the hardware events a command causes.", &manPerfstat},
+    { &schedCmd, "sched", "Show or change the scheduling policy.", &manSched},
+    { &niceCmd, "nice", "Show or change how nice processes are.", &manNice},
+    { &memstatCmd, "memstat", "Display how the kernel's memory is used.", &manMemstat},
+    { &lockstatCmd, "lockstat", "Display how contended the kernel's locks are.", &manLockstat},
+    { &burnCmd, "burn", "Check how CPU-bound work scales across CPUs.", &manBurn},
+    { &inheritCmd, "inherit", "Check that lock holders inherit priorities.", &manInherit},
+    { &threadsCmd, "threads", "Check threads and the locks they share.", &manThreads}
 };
 
-static termios shellStatus = { 0, 0 };
+static termios shellStatus = { 0, 0, 0 };
 
 /**
  * Shell entry poing.
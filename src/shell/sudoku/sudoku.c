@@ -105,7 +105,7 @@ static const char *boards[] = {
 
 const size_t boardLeft = 30, boardTop = 4;
 
-static termios gameStatus = { 0, 0 };
+static termios gameStatus = { 0, 0, 0 };
 
 static void intro(void);
 
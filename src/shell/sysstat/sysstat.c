@@ -0,0 +1,69 @@
+#include "shell/sysstat/sysstat.h"
+#include "library/stdio.h"
+#include "library/string.h"
+#include "library/sys.h"
+#include "library/div64.h"
+#include "system/call/codes.h"
+#include "mcurses/mcurses.h"
+#include "type.h"
+
+static void printCycles(unsigned long long cycles);
+
+/**
+ * Print a cycle count, in millions once it doesn't fit in an int.
+ *
+ * @param cycles The cycle count.
+ */
+void printCycles(unsigned long long cycles) {
+
+    if (cycles < 1000000000u) {
+        printf("%u\t", (unsigned int) cycles);
+    } else {
+        printf("%uM\t", (unsigned int) uint64_div64(cycles, 1000000u));
+    }
+}
+
+/**
+ * Command that shows how many times each system call was made, and how long they took.
+ *
+ * @param argv A string containg everything that came after the command.
+ */
+void sysstatCmd(char* argv) {
+
+    (void) argv;
+
+    struct SyscallInfo data[_SYS_COUNT];
+    int count = sysstat(data, _SYS_COUNT);
+
+    printf("NAME\t\tCALLS\tAVG\tMAX\tTOTAL (cycles)\n");
+
+    for (int i = 0; i < count; i++) {
+
+        if (data[i].calls == 0) {
+            continue;
+        }
+
+        printf("%s\t", data[i].name);
+        if (strlen(data[i].name) < 8) {
+            printf("\t");
+        }
+
+        printf("%u\t", data[i].calls);
+        printCycles(uint64_div64(data[i].cycles, data[i].calls));
+        printCycles(data[i].maxCycles);
+        printCycles(data[i].cycles);
+        printf("\n");
+    }
+}
+
+/**
+ * Print manual page for the sysstat command.
+ */
+void manSysstat(void) {
+    setBold(1);
+    printf("Usage:\n\t sysstat\n");
+    setBold(0);
+
+    printf("\n\tShows how many times each system call was made, and the average,\n");
+    printf("\tlongest and total cycles spent in it.\n");
+}
@@ -0,0 +1,8 @@
+#ifndef _shell_sysstat_header_
+#define _shell_sysstat_header_
+
+void sysstatCmd(char* argv);
+
+void manSysstat(void);
+
+#endif
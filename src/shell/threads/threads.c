@@ -0,0 +1,208 @@
+#include "shell/threads/threads.h"
+#include "library/stdio.h"
+#include "library/stdlib.h"
+#include "library/sys.h"
+#include "library/threads.h"
+#include "mcurses/mcurses.h"
+#include "type.h"
+
+#define WORKERS 4
+
+// Times each worker bumps the shared counter
+#define ROUNDS 10000
+
+// How many workers the semaphore lets in at once, and how long each stays
+#define SLOTS 2
+#define SLOT_MS 20
+
+// Long enough for the threads of a process that was just started to block
+#define SETTLE_MS 100
+
+// How long a killed process gets to go away
+#define KILL_TIMEOUT_MS 1000
+
+static mtx_t lock = MTX_INITIALIZER;
+static cnd_t finishedCond = CND_INITIALIZER;
+static sem_t slots;
+
+static volatile int counter;
+static volatile int finished;
+static volatile int inside;
+static volatile int mostInside;
+
+// What the threads of the killed process block on, apart from the rest
+static mtx_t stuckLock = MTX_INITIALIZER;
+static cnd_t never = CND_INITIALIZER;
+
+static int worker(void* arg);
+
+static int stuck(void* unused);
+
+static void stuckProcess(char* unused);
+
+static int killed(void);
+
+/**
+ * A thread that takes the lock ROUNDS times, waits for a slot, and says it's done.
+ *
+ * Odd workers end with thread_exit, even ones return.
+ *
+ * @param arg The worker's index, which is also its exit status.
+ */
+int worker(void* arg) {
+
+    int index = (int) arg;
+
+    for (int i = 0; i < ROUNDS; i++) {
+        mtx_lock(&lock);
+        counter++;
+        mtx_unlock(&lock);
+    }
+
+    sem_wait(&slots);
+
+    mtx_lock(&lock);
+    inside++;
+    if (inside > mostInside) {
+        mostInside = inside;
+    }
+    mtx_unlock(&lock);
+
+    // Stay long enough for the others to pile up behind the semaphore
+    sleep(SLOT_MS);
+
+    mtx_lock(&lock);
+    inside--;
+    mtx_unlock(&lock);
+
+    sem_post(&slots);
+
+    mtx_lock(&lock);
+    finished++;
+    cnd_broadcast(&finishedCond);
+    mtx_unlock(&lock);
+
+    if (index % 2) {
+        thread_exit(index);
+    }
+
+    return index;
+}
+
+/**
+ * A thread that waits on a condition nobody signals.
+ */
+int stuck(void* unused) {
+
+    (void) unused;
+
+    mtx_lock(&stuckLock);
+    while (1) {
+        cnd_wait(&never, &stuckLock);
+    }
+
+    return 0;
+}
+
+/**
+ * A process whose threads, main one included, all block forever.
+ */
+void stuckProcess(char* unused) {
+
+    (void) unused;
+
+    for (int i = 0; i < WORKERS; i++) {
+        thread_create(stuck, NULL);
+    }
+
+    stuck(NULL);
+}
+
+/**
+ * Kill a process while its threads are blocked, and wait for it.
+ *
+ * @return 1 if it was gone in time, 0 otherwise.
+ */
+int killed(void) {
+
+    // A kill can leave them anywhere, so they start over every time
+    mtx_init(&stuckLock);
+    cnd_init(&never);
+
+    pid_t pid = run(stuckProcess, NULL, 0);
+
+    sleep(SETTLE_MS);
+    kill(pid);
+
+    return timedwait(KILL_TIMEOUT_MS) == pid;
+}
+
+/**
+ * Command that checks threads, and the locks they share.
+ *
+ * Some workers bump a counter under a mutex, and then go through a
+ * semaphore that lets fewer of them in than there are. The command waits
+ * for all of them on a condition variable, and joins them. Then it kills
+ * a process whose threads are all blocked, and waits for it to go away.
+ *
+ * @param argv A string containg everything that came after the command.
+ */
+void threadsCmd(char* argv) {
+
+    (void) argv;
+
+    pid_t tids[WORKERS];
+    int created = 0;
+    int joined = 0;
+
+    mtx_init(&lock);
+    cnd_init(&finishedCond);
+    counter = 0;
+    finished = 0;
+    inside = 0;
+    mostInside = 0;
+    sem_init(&slots, SLOTS);
+
+    for (int i = 0; i < WORKERS; i++) {
+        tids[i] = thread_create(worker, (void*) i);
+        if (tids[i] != -1) {
+            created++;
+        }
+    }
+
+    mtx_lock(&lock);
+    while (finished < created) {
+        cnd_wait(&finishedCond, &lock);
+    }
+    mtx_unlock(&lock);
+
+    for (int i = 0; i < WORKERS; i++) {
+
+        int status;
+        if (tids[i] != -1 && thread_join(tids[i], &status) == 0 && status == i) {
+            joined++;
+        }
+    }
+
+    int gone = killed();
+
+    printf("Threads: %d of %d created, %d joined\n", created, WORKERS, joined);
+    printf("Counter: %d of %d\n", counter, WORKERS * ROUNDS);
+    printf("Most at once through the semaphore: %d of %d\n", mostInside, SLOTS);
+    printf("Killed with blocked threads: %s\n", gone ? "yes" : "no");
+
+    int pass = created == WORKERS && joined == WORKERS && counter == WORKERS * ROUNDS &&
+        mostInside > 0 && mostInside <= SLOTS && gone;
+
+    printf("%s\n", pass ? "PASS" : "FAIL");
+}
+
+void manThreads(void) {
+    setBold(1);
+    printf("Usage:\n\t threads\n");
+    setBold(0);
+
+    printf("\n\tRuns %d threads that share a mutex, a condition variable and a\n", WORKERS);
+    printf("\tsemaphore, joins them, and kills a process whose threads are all\n");
+    printf("\tblocked. Shows what each part gave, and PASS if it was all right.\n");
+}
@@ -0,0 +1,8 @@
+#ifndef __SHELL_THREADS__
+#define __SHELL_THREADS__
+
+void threadsCmd(char* argv);
+
+void manThreads(void);
+
+#endif
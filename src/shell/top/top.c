@@ -3,43 +3,137 @@
 #include "library/stdlib.h"
 #include "library/time.h"
 #include "library/sys.h"
+#include "library/div64.h"
 #include "system/call/codes.h"
 #include "system/call/ioctl/keyboard.h"
 #include "type.h"
 #include "mcurses/mcurses.h"
 
-void top(char* argv) {
+// Where the snapshot buffer starts, it grows to whatever the kernel says there is
+#define TOP_FIRST_CAPACITY 16
 
-    static termios oldStatus;
-    static termios topStatus = { 0, 0 };
+// Room left for processes started between two refreshes
+#define TOP_SLACK 4
 
-    ioctl(0, TCGETS, (void*) &oldStatus);
-    ioctl(0, TCSETS, (void*) &topStatus);
-    
-    // Reset the screen
-    moveCursor(1, 1);
-    clearScreen(CLEAR_ALL);
+// Tenths of a second between refreshes
+#define TOP_INTERVAL 10
 
-    struct ProcessInfo data[20];
-    int pcount = pinfo(data, 20);
-    
-    printf("PID\tPPID\tUSER\t%%CPU\tPRIO\tSTATE\tSTART DATE\n");
+static const char* stateNames[] = { "run", "ready", "blocked", "zombie" };
+
+static struct ProcessSnapshot* previous(struct ProcessSnapshot* snapshot, int count, pid_t pid);
+
+static int percent(unsigned long long part, unsigned long long total);
+
+static size_t show(size_t capacity);
+
+/**
+ * Find a process in a snapshot.
+ *
+ * @return The entry for pid, or NULL if it wasn't there.
+ */
+struct ProcessSnapshot* previous(struct ProcessSnapshot* snapshot, int count, pid_t pid) {
+
+    for (int i = 0; i < count; i++) {
+        if (snapshot[i].pid == pid) {
+            return &snapshot[i];
+        }
+    }
+
+    return NULL;
+}
+
+int percent(unsigned long long part, unsigned long long total) {
+
+    if (total == 0) {
+        return 0;
+    }
+
+    return uint64_div64(part * 100, total);
+}
+
+/**
+ * Refresh the process list until q is pressed, or there are too many processes.
+ *
+ * @param capacity How many processes fit in each snapshot.
+ *
+ * @return 0 if q was pressed, otherwise how many processes have to fit.
+ */
+size_t show(size_t capacity) {
+
+    struct ProcessSnapshot snapshots[2][capacity];
+    struct ProcessSnapshotHeader headers[2];
+    int counts[2] = { 0, 0 };
+    int curr = 0;
+
+    headers[1].cycles = 0;
 
     do {
+        int prev = !curr;
+        struct ProcessSnapshot* data = snapshots[curr];
+
+        headers[curr].version = PSNAPSHOT_VERSION;
+        counts[curr] = psnapshot(&headers[curr], data, sizeof(snapshots[curr]));
+
+        if (counts[curr] >= 0 && (size_t) counts[curr] < headers[curr].total) {
+            return headers[curr].total + TOP_SLACK;
+        }
+
+        // The first time around there's nothing to compare against, so it's the lifetime figures
+        unsigned long long elapsed = headers[curr].cycles - headers[prev].cycles;
+
         moveCursor(2, 1);
-        for (int i = 0; i < pcount; i++) {
+        clearScreen(CLEAR_BELOW);
+
+        for (int i = 0; i < counts[curr]; i++) {
+
+            unsigned long long cycles = data[i].cycles;
+            unsigned long long waitCycles = data[i].waitCycles;
+
+            struct ProcessSnapshot* before = previous(snapshots[prev], counts[prev], data[i].pid);
+            if (before != NULL) {
+                cycles -= before->cycles;
+                waitCycles -= before->waitCycles;
+            }
+
             printf("%d\t", data[i].pid);
             printf("%d\t", data[i].ppid);
-            printf("%s\t", "acrespo");
-            printf("%d\t", data[i].cputime);
-            printf("%d\t",data[i].priority);
-            printf("%s\t", (data[i].state)? "alive":  "zombie");
-            printf("%s",asctime(localtime(&data[i].timeStart)));
+            printf("%d\t", percent(cycles, elapsed));
+            printf("%d\t", percent(waitCycles, elapsed));
+            printf("%d\t", data[i].priority);
+            printf("%d\t", data[i].nice);
+            printf("%s\t", stateNames[data[i].state]);
+            printf("%u\t", data[i].voluntarySwitches);
+            printf("%u\t", data[i].involuntarySwitches);
+            printf("%u", data[i].memoryPages * 4);
             printf("\n");
         }
 
+        curr = prev;
+
     } while(getchar() != 'q');
 
+    return 0;
+}
+
+void top(char* argv) {
+
+    static termios oldStatus;
+    static termios topStatus = { 0, 0, TOP_INTERVAL };
+
+    size_t capacity = TOP_FIRST_CAPACITY;
+
+    ioctl(0, TCGETS, (void*) &oldStatus);
+    ioctl(0, TCSETS, (void*) &topStatus);
+
+    // Reset the screen
+    moveCursor(1, 1);
+    clearScreen(CLEAR_ALL);
+
+    printf("PID\tPPID\t%%CPU\t%%WAIT\tPRIO\tNI\tSTATE\tVCSW\tIVCSW\tMEM(K)\n");
+
+    // Whenever the snapshot doesn't fit, start over with one that does
+    while ((capacity = show(capacity)) != 0);
+
     clearScreen(CLEAR_ALL);
     moveCursor(0, 0);
     ioctl(0, TCSETS, (void*) &oldStatus);
@@ -51,4 +145,6 @@ void manTop(void) {
     setBold(1);
     printf("Usage:\n\t top\n");
     setBold(0);
+
+    printf("\n\tRefreshes every second, press q to quit.\n");
 }
@@ -0,0 +1,84 @@
+#include "system/apic.h"
+#include "system/cpu.h"
+#include "system/paging.h"
+#include "system/mm.h"
+#include "type.h"
+
+#define IA32_APIC_BASE 0x1B
+#define APIC_BASE_ENABLE (0x1u << 11)
+#define APIC_BASE_MASK 0xFFFFF000u
+
+#define SVR_ENABLE (0x1u << 8)
+
+static volatile unsigned int* lapic = NULL;
+
+/**
+ * Map and software enable the local APIC of this CPU.
+ *
+ * Every CPU calls it for its own, the mapping is shared.
+ *
+ * LINT0 is left as the BIOS set it up, so the PIC keeps delivering interrupts.
+ *
+ * @return 0 on success, -1 if there's no usable local APIC.
+ */
+int lapic_init(void) {
+
+    if (!cpu_has(CPU_APIC) || !cpu_has(CPU_MSR)) {
+        return -1;
+    }
+
+    unsigned long long base = rdmsr(IA32_APIC_BASE);
+    wrmsr(IA32_APIC_BASE, base | APIC_BASE_ENABLE);
+
+    void* address = (void*) ((unsigned int) base & APIC_BASE_MASK);
+    if ((size_t) address >= IDENTITY_MAP_END &&
+            paging_map(paging_kernel_space(), address, address, PAGE_WRITE | PAGE_NOCACHE) != 0) {
+        return -1;
+    }
+
+    lapic = (volatile unsigned int*) address;
+    lapic_write(LAPIC_SVR, SVR_ENABLE | SPURIOUS_VECTOR);
+
+    return 0;
+}
+
+int lapic_present(void) {
+    return lapic != NULL;
+}
+
+unsigned int lapic_read(unsigned int reg) {
+    return lapic[reg / sizeof(unsigned int)];
+}
+
+void lapic_write(unsigned int reg, unsigned int value) {
+    lapic[reg / sizeof(unsigned int)] = value;
+}
+
+void lapic_eoi(void) {
+    lapic_write(LAPIC_EOI, 0);
+}
+
+/**
+ * Where a local APIC register is, it's the same address on every CPU.
+ */
+const volatile unsigned int* lapic_register(unsigned int reg) {
+    return &lapic[reg / sizeof(unsigned int)];
+}
+
+unsigned int lapic_id(void) {
+    return lapic_read(LAPIC_ID) >> 24;
+}
+
+/**
+ * Send an interrupt to another CPU, and wait until it's been delivered.
+ *
+ * @param apicId The local APIC id of the destination.
+ * @param command The delivery mode, and the vector for fixed and startup IPIs.
+ */
+void lapic_send_ipi(unsigned int apicId, unsigned int command) {
+
+    lapic_write(LAPIC_ICR_HIGH, apicId << 24);
+    lapic_write(LAPIC_ICR_LOW, command);
+
+    while (lapic_read(LAPIC_ICR_LOW) & LAPIC_IPI_PENDING);
+}
@@ -0,0 +1,41 @@
+#ifndef __SYSTEM_APIC__
+#define __SYSTEM_APIC__
+
+#define LAPIC_ID 0x20
+#define LAPIC_EOI 0xB0
+#define LAPIC_SVR 0xF0
+#define LAPIC_ICR_LOW 0x300
+#define LAPIC_ICR_HIGH 0x310
+#define LAPIC_LVT_TIMER 0x320
+#define LAPIC_TIMER_INITIAL 0x380
+#define LAPIC_TIMER_CURRENT 0x390
+#define LAPIC_TIMER_DIVIDE 0x3E0
+
+#define LAPIC_TIMER_PERIODIC (0x1u << 17)
+#define LAPIC_MASKED (0x1u << 16)
+
+// Inter-processor interrupts, as written to the low half of the ICR
+#define LAPIC_IPI_FIXED 0x00004000u
+#define LAPIC_IPI_INIT 0x00004500u
+#define LAPIC_IPI_STARTUP 0x00004600u
+#define LAPIC_IPI_PENDING (0x1u << 12)
+
+#define SPURIOUS_VECTOR 0xFF
+
+int lapic_init(void);
+
+int lapic_present(void);
+
+unsigned int lapic_read(unsigned int reg);
+
+void lapic_write(unsigned int reg, unsigned int value);
+
+void lapic_eoi(void);
+
+const volatile unsigned int* lapic_register(unsigned int reg);
+
+unsigned int lapic_id(void);
+
+void lapic_send_ipi(unsigned int apicId, unsigned int command);
+
+#endif
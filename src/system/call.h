@@ -11,6 +11,10 @@ int _ioctl(int fd, int cmd, void* argp);
 
 time_t _time(time_t *tp);
 
+int _clock_gettime(int clock, struct timespec* tp);
+
+int _nanosleep(const struct timespec* req, struct timespec* rem);
+
 pid_t _getpid(void);
 
 pid_t _getppid(void);
@@ -19,8 +23,48 @@ pid_t _run(void(*EntryPoint)(char*), char* args, int active);
 
 void _exit(void);
 
-pid_t _wait(void);
+pid_t _wait(unsigned int timeout);
+
+void _kill(pid_t pid);
+
+pid_t _thread_create(void (*start)(void*, void*), void* entry, void* arg);
+
+void _thread_exit(int status);
+
+int _thread_join(pid_t tid, int* status);
+
+int _psnapshot(struct ProcessSnapshotHeader* header, void* buffer, size_t length);
+
+int _sysstat(struct SyscallInfo* data, size_t size);
+
+int _profile(int cmd, void* buffer, size_t length);
+
+int _ksymbol(unsigned int address, struct KernelSymbol* symbol);
+
+int _perfstat(int who, struct PerfCounters* data);
+
+int _futex_wait(int* address, int value, unsigned int timeout);
+
+int _futex_wake(int* address, int count);
+
+int _sched_setdeadline(pid_t pid, const struct DeadlineParams* params);
+
+int _sched_setscheduler(pid_t pid, int policy);
+
+int _sched_setdefault(int policy);
+
+int _nice(int increment);
+
+int _setpriority(pid_t pid, int nice);
+
+int _memstat(struct MemStats* data);
+
+int _lockstat(struct LockInfo* data, size_t size);
+
+int syscall_dispatch(int eax, int ebx, int ecx, int edx);
+
+int syscall_enter(int eax, int ebx, int ecx, int edx);
 
-int _pinfo(struct ProcessInfo* data, size_t size);
+void syscall_init(void);
 
 #endif
@@ -1,23 +1,45 @@
 #ifndef     _system_call_codes_header_
 #define     _system_call_codes_header_
 
-#define     _SYS_READ       3
-#define     _SYS_WRITE      4
-#define     _SYS_IOCTL      54
+// Codes are dense, they index the dispatch table in system/call/dispatch.c
+#define     _SYS_READ                   0
+#define     _SYS_WRITE                  1
+#define     _SYS_IOCTL                  2
 
-#define     _SYS_TIME       13
-#define     _SYS_TICKS      191
+#define     _SYS_TIME                   3
+// Also hardcoded in shell/getCPUSpeed/getCPUSpeed.asm
+#define     _SYS_TICKS                  4
+#define     _SYS_CLOCK_GETTIME          5
+#define     _SYS_NANOSLEEP              6
 
-#define     _SYS_PINFO      999
+#define     _SYS_PSNAPSHOT              7
+#define     _SYS_SYSSTAT                8
 
-#define _SYS_EXIT 93
-#define _SYS_YIELD 124
-#define _SYS_GETPID 172
-#define _SYS_GETPPID 173
-#define _SYS_WAIT 1072
-#define _SYS_KILL 129
+#define     _SYS_EXIT                   9
+#define     _SYS_YIELD                  10
+#define     _SYS_GETPID                 11
+#define     _SYS_GETPPID                12
+#define     _SYS_WAIT                   13
+#define     _SYS_KILL                   14
 
+#define     _SYS_RUN                    15
 
-#define _SYS_RUN 1
+#define     _SYS_PROFILE                16
+#define     _SYS_KSYMBOL                17
+#define     _SYS_PERFSTAT               18
+#define     _SYS_FUTEX_WAIT             19
+#define     _SYS_FUTEX_WAKE             20
+#define     _SYS_THREAD_CREATE          21
+#define     _SYS_THREAD_EXIT            22
+#define     _SYS_THREAD_JOIN            23
+#define     _SYS_SCHED_SETDEADLINE      24
+#define     _SYS_SCHED_SETSCHEDULER     25
+#define     _SYS_SCHED_SETDEFAULT       26
+#define     _SYS_NICE                   27
+#define     _SYS_SETPRIORITY            28
+#define     _SYS_MEMSTAT                29
+#define     _SYS_LOCKSTAT               30
+
+#define     _SYS_COUNT                  31
 
 #endif
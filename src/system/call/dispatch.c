@@ -0,0 +1,441 @@
+#include "system/call.h"
+#include "system/call/codes.h"
+#include "system/tick.h"
+#include "system/cpu.h"
+#include "system/gdt.h"
+#include "system/scheduler.h"
+#include "system/smp.h"
+
+#define SYSENTER_CS_MSR 0x174
+#define SYSENTER_ESP_MSR 0x175
+#define SYSENTER_EIP_MSR 0x176
+
+// SYSENTER needs a stack to land on, even if the entry point leaves it right away
+#define SYSENTER_STACK_SIZE 256
+
+// Bits for the arguments that must not be NULL
+#define ARG1 0x1
+#define ARG2 0x2
+#define ARG3 0x4
+
+typedef int (*SystemCall)(int ebx, int ecx, int edx);
+
+struct SystemCallEntry {
+    SystemCall handler;
+    const char* name;
+    int nonNull;
+};
+
+struct SystemCallStats {
+    size_t calls;
+    unsigned long long cycles;
+    unsigned long long maxCycles;
+};
+
+extern void _sysenterEntry(void);
+
+static int sys_read(int ebx, int ecx, int edx);
+
+static int sys_write(int ebx, int ecx, int edx);
+
+static int sys_time(int ebx, int ecx, int edx);
+
+static int sys_clock_gettime(int ebx, int ecx, int edx);
+
+static int sys_nanosleep(int ebx, int ecx, int edx);
+
+static int sys_ioctl(int ebx, int ecx, int edx);
+
+static int sys_ticks(int ebx, int ecx, int edx);
+
+static int sys_yield(int ebx, int ecx, int edx);
+
+static int sys_exit(int ebx, int ecx, int edx);
+
+static int sys_getpid(int ebx, int ecx, int edx);
+
+static int sys_getppid(int ebx, int ecx, int edx);
+
+static int sys_run(int ebx, int ecx, int edx);
+
+static int sys_wait(int ebx, int ecx, int edx);
+
+static int sys_kill(int ebx, int ecx, int edx);
+
+static int sys_psnapshot(int ebx, int ecx, int edx);
+
+static int sys_sysstat(int ebx, int ecx, int edx);
+
+static int sys_profile(int ebx, int ecx, int edx);
+
+static int sys_ksymbol(int ebx, int ecx, int edx);
+
+static int sys_perfstat(int ebx, int ecx, int edx);
+
+static int sys_futex_wait(int ebx, int ecx, int edx);
+
+static int sys_futex_wake(int ebx, int ecx, int edx);
+
+static int sys_thread_create(int ebx, int ecx, int edx);
+
+static int sys_thread_exit(int ebx, int ecx, int edx);
+
+static int sys_thread_join(int ebx, int ecx, int edx);
+
+static int sys_sched_setdeadline(int ebx, int ecx, int edx);
+
+static int sys_sched_setscheduler(int ebx, int ecx, int edx);
+
+static int sys_sched_setdefault(int ebx, int ecx, int edx);
+
+static int sys_nice(int ebx, int ecx, int edx);
+
+static int sys_setpriority(int ebx, int ecx, int edx);
+
+static int sys_memstat(int ebx, int ecx, int edx);
+
+static int sys_lockstat(int ebx, int ecx, int edx);
+
+static const struct SystemCallEntry table[] = {
+    [_SYS_READ] = { sys_read, "read", ARG2 },
+    [_SYS_WRITE] = { sys_write, "write", ARG2 },
+    [_SYS_IOCTL] = { sys_ioctl, "ioctl", 0 },
+    [_SYS_TIME] = { sys_time, "time", 0 },
+    [_SYS_TICKS] = { sys_ticks, "ticks", 0 },
+    [_SYS_CLOCK_GETTIME] = { sys_clock_gettime, "clock_gettime", ARG2 },
+    [_SYS_NANOSLEEP] = { sys_nanosleep, "nanosleep", ARG1 },
+    [_SYS_PSNAPSHOT] = { sys_psnapshot, "psnapshot", ARG1 | ARG2 },
+    [_SYS_SYSSTAT] = { sys_sysstat, "sysstat", ARG1 },
+    [_SYS_EXIT] = { sys_exit, "exit", 0 },
+    [_SYS_YIELD] = { sys_yield, "yield", 0 },
+    [_SYS_GETPID] = { sys_getpid, "getpid", 0 },
+    [_SYS_GETPPID] = { sys_getppid, "getppid", 0 },
+    [_SYS_WAIT] = { sys_wait, "wait", 0 },
+    [_SYS_KILL] = { sys_kill, "kill", 0 },
+    [_SYS_RUN] = { sys_run, "run", ARG1 },
+    [_SYS_PROFILE] = { sys_profile, "profile", 0 },
+    [_SYS_KSYMBOL] = { sys_ksymbol, "ksymbol", ARG2 },
+    [_SYS_PERFSTAT] = { sys_perfstat, "perfstat", ARG2 },
+    [_SYS_FUTEX_WAIT] = { sys_futex_wait, "futex_wait", ARG1 },
+    [_SYS_FUTEX_WAKE] = { sys_futex_wake, "futex_wake", ARG1 },
+    [_SYS_THREAD_CREATE] = { sys_thread_create, "thread_create", ARG1 | ARG2 },
+    [_SYS_THREAD_EXIT] = { sys_thread_exit, "thread_exit", 0 },
+    [_SYS_THREAD_JOIN] = { sys_thread_join, "thread_join", 0 },
+    [_SYS_SCHED_SETDEADLINE] = { sys_sched_setdeadline, "sched_setdeadline", 0 },
+    [_SYS_SCHED_SETSCHEDULER] = { sys_sched_setscheduler, "sched_setscheduler", 0 },
+    [_SYS_SCHED_SETDEFAULT] = { sys_sched_setdefault, "sched_setdefault", 0 },
+    [_SYS_NICE] = { sys_nice, "nice", 0 },
+    [_SYS_SETPRIORITY] = { sys_setpriority, "setpriority", 0 },
+    [_SYS_MEMSTAT] = { sys_memstat, "memstat", ARG1 },
+    [_SYS_LOCKSTAT] = { sys_lockstat, "lockstat", ARG1 },
+};
+
+#define TABLE_SIZE (sizeof(table) / sizeof(table[0]))
+
+// Fails to compile if the last code has no entry. A code left out in the
+// middle leaves a hole instead, which syscall_dispatch refuses to call.
+typedef char table_matches_codes[(TABLE_SIZE == _SYS_COUNT) ? 1 : -1];
+
+static struct SystemCallStats stats[_SYS_COUNT];
+
+static char sysenterStack[SYSENTER_STACK_SIZE];
+
+int sys_read(int ebx, int ecx, int edx) {
+    return _read((unsigned int) ebx, (char*) ecx, (size_t) edx);
+}
+
+int sys_write(int ebx, int ecx, int edx) {
+    return _write((unsigned int) ebx, (const char*) ecx, (size_t) edx);
+}
+
+int sys_time(int ebx, int ecx, int edx) {
+    (void) ecx;
+    (void) edx;
+
+    return _time((time_t*) ebx);
+}
+
+int sys_clock_gettime(int ebx, int ecx, int edx) {
+    (void) edx;
+
+    return _clock_gettime(ebx, (struct timespec*) ecx);
+}
+
+int sys_nanosleep(int ebx, int ecx, int edx) {
+    (void) edx;
+
+    return _nanosleep((const struct timespec*) ebx, (struct timespec*) ecx);
+}
+
+int sys_ioctl(int ebx, int ecx, int edx) {
+    return _ioctl(ebx, ecx, (void*) edx);
+}
+
+int sys_ticks(int ebx, int ecx, int edx) {
+    (void) ebx;
+    (void) ecx;
+    (void) edx;
+
+    return _getTicksSinceStart();
+}
+
+int sys_yield(int ebx, int ecx, int edx) {
+    (void) ebx;
+    (void) ecx;
+    (void) edx;
+
+    scheduler_yield();
+    return 0;
+}
+
+int sys_exit(int ebx, int ecx, int edx) {
+    (void) ebx;
+    (void) ecx;
+    (void) edx;
+
+    _exit();
+    return 0;
+}
+
+int sys_getpid(int ebx, int ecx, int edx) {
+    (void) ebx;
+    (void) ecx;
+    (void) edx;
+
+    return _getpid();
+}
+
+int sys_getppid(int ebx, int ecx, int edx) {
+    (void) ebx;
+    (void) ecx;
+    (void) edx;
+
+    return _getppid();
+}
+
+int sys_run(int ebx, int ecx, int edx) {
+    return _run((void(*)(char*)) ebx, (char*) ecx, edx);
+}
+
+int sys_wait(int ebx, int ecx, int edx) {
+    (void) ecx;
+    (void) edx;
+
+    return _wait((unsigned int) ebx);
+}
+
+int sys_kill(int ebx, int ecx, int edx) {
+    (void) ecx;
+    (void) edx;
+
+    _kill((pid_t) ebx);
+    return 0;
+}
+
+int sys_psnapshot(int ebx, int ecx, int edx) {
+    return _psnapshot((struct ProcessSnapshotHeader*) ebx, (void*) ecx, (size_t) edx);
+}
+
+int sys_sysstat(int ebx, int ecx, int edx) {
+    (void) edx;
+
+    return _sysstat((struct SyscallInfo*) ebx, (size_t) ecx);
+}
+
+int sys_profile(int ebx, int ecx, int edx) {
+    return _profile(ebx, (void*) ecx, (size_t) edx);
+}
+
+int sys_ksymbol(int ebx, int ecx, int edx) {
+    (void) edx;
+
+    return _ksymbol((unsigned int) ebx, (struct KernelSymbol*) ecx);
+}
+
+int sys_perfstat(int ebx, int ecx, int edx) {
+    (void) edx;
+
+    return _perfstat(ebx, (struct PerfCounters*) ecx);
+}
+
+int sys_futex_wait(int ebx, int ecx, int edx) {
+    return _futex_wait((int*) ebx, ecx, (unsigned int) edx);
+}
+
+int sys_futex_wake(int ebx, int ecx, int edx) {
+    (void) edx;
+
+    return _futex_wake((int*) ebx, ecx);
+}
+
+int sys_thread_create(int ebx, int ecx, int edx) {
+    return _thread_create((ThreadStart) ebx, (void*) ecx, (void*) edx);
+}
+
+int sys_thread_exit(int ebx, int ecx, int edx) {
+    (void) ecx;
+    (void) edx;
+
+    _thread_exit(ebx);
+    return 0;
+}
+
+int sys_thread_join(int ebx, int ecx, int edx) {
+    (void) edx;
+
+    return _thread_join((pid_t) ebx, (int*) ecx);
+}
+
+int sys_sched_setdeadline(int ebx, int ecx, int edx) {
+    (void) edx;
+
+    return _sched_setdeadline((pid_t) ebx, (const struct DeadlineParams*) ecx);
+}
+
+int sys_sched_setscheduler(int ebx, int ecx, int edx) {
+    (void) edx;
+
+    return _sched_setscheduler((pid_t) ebx, ecx);
+}
+
+int sys_sched_setdefault(int ebx, int ecx, int edx) {
+    (void) ecx;
+    (void) edx;
+
+    return _sched_setdefault(ebx);
+}
+
+int sys_nice(int ebx, int ecx, int edx) {
+    (void) ecx;
+    (void) edx;
+
+    return _nice(ebx);
+}
+
+int sys_setpriority(int ebx, int ecx, int edx) {
+    (void) edx;
+
+    return _setpriority((pid_t) ebx, ecx);
+}
+
+int sys_memstat(int ebx, int ecx, int edx) {
+    (void) ecx;
+    (void) edx;
+
+    return _memstat((struct MemStats*) ebx);
+}
+
+int sys_lockstat(int ebx, int ecx, int edx) {
+    (void) edx;
+
+    return _lockstat((struct LockInfo*) ebx, (size_t) ecx);
+}
+
+/**
+ * Run a system call.
+ *
+ * @param eax The system call code.
+ * @param ebx First argument.
+ * @param ecx Second argument.
+ * @param edx Third argument.
+ *
+ * @return What the system call returns, -1 if the code is not known
+ *         or a required pointer is NULL.
+ */
+int syscall_dispatch(int eax, int ebx, int ecx, int edx) {
+
+    if ((unsigned int) eax >= TABLE_SIZE) {
+        return -1;
+    }
+
+    const struct SystemCallEntry* entry = &table[eax];
+    if (entry->handler == NULL) {
+        return -1;
+    }
+
+    if (((entry->nonNull & ARG1) && ebx == 0) ||
+        ((entry->nonNull & ARG2) && ecx == 0) ||
+        ((entry->nonNull & ARG3) && edx == 0)) {
+        return -1;
+    }
+
+    // Counted up front, since some calls never come back
+    stats[eax].calls++;
+
+    unsigned long long start = rdtsc();
+    int ret = entry->handler(ebx, ecx, edx);
+    unsigned long long elapsed = rdtsc() - start;
+
+    stats[eax].cycles += elapsed;
+    if (elapsed > stats[eax].maxCycles) {
+        stats[eax].maxCycles = elapsed;
+    }
+
+    return ret;
+}
+
+/**
+ * System call that reports how much every system call was used.
+ *
+ * @param data Where to write the info, one entry per system call there is.
+ * @param size How many entries fit in data.
+ *
+ * @return The number of entries written.
+ */
+int _sysstat(struct SyscallInfo* data, size_t size) {
+
+    size_t count = 0;
+    for (size_t i = 0; i < TABLE_SIZE && count < size; i++) {
+
+        if (table[i].handler == NULL) {
+            continue;
+        }
+
+        size_t j;
+        for (j = 0; table[i].name[j] && j < SYSCALL_NAME_LEN - 1; j++) {
+            data[count].name[j] = table[i].name[j];
+        }
+        data[count].name[j] = 0;
+
+        data[count].calls = stats[i].calls;
+        data[count].cycles = stats[i].cycles;
+        data[count].maxCycles = stats[i].maxCycles;
+        count++;
+    }
+
+    return count;
+}
+
+/**
+ * Called from the SYSENTER entry point, on the caller's stack.
+ *
+ * There's no interrupt to return from, so this is where we get to switch
+ * processes if the call asked for it. A process blocked here may be woken
+ * up by a PIC interrupt, but that one's acknowledged by interruptDispatcher
+ * before it switches, so nothing's owed to the PIC on the way out.
+ */
+int syscall_enter(int eax, int ebx, int ecx, int edx) {
+
+    smp_lock_kernel();
+
+    int ret = syscall_dispatch(eax, ebx, ecx, edx);
+    scheduler_preempt();
+
+    smp_unlock_kernel();
+
+    return ret;
+}
+
+/**
+ * Set up the SYSENTER MSRs, if the CPU has them.
+ */
+void syscall_init(void) {
+
+    if (!cpu_has(CPU_SEP)) {
+        return;
+    }
+
+    wrmsr(SYSENTER_CS_MSR, KERNEL_CODE_SELECTOR);
+    wrmsr(SYSENTER_ESP_MSR, (unsigned int) (sysenterStack + SYSENTER_STACK_SIZE));
+    wrmsr(SYSENTER_EIP_MSR, (unsigned int) &_sysenterEntry);
+}
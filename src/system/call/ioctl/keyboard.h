@@ -9,6 +9,9 @@
 typedef struct {
     byte canon;
     byte echo;
+    // Like VTIME, in tenths of a second. When not canonical and non zero,
+    // a read returns whatever arrived once that time passes.
+    byte time;
 } termios;
 
 #endif
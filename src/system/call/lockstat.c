@@ -0,0 +1,20 @@
+#include "system/call.h"
+#include "system/sync.h"
+
+/**
+ * System call that reports how much the registered locks were used and fought over.
+ *
+ * @param data Where to write the info, one entry per lock.
+ * @param size How many entries fit in data.
+ *
+ * @return The number of entries written.
+ */
+int _lockstat(struct LockInfo* data, size_t size) {
+
+    size_t count = 0;
+    while (count < size && lock_stats_read(count, &data[count]) == 0) {
+        count++;
+    }
+
+    return count;
+}
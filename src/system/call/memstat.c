@@ -0,0 +1,29 @@
+#include "system/call.h"
+#include "system/slab.h"
+#include "system/paging.h"
+#include "library/stdlib.h"
+
+/**
+ * System call that reports how the kernel's memory is used.
+ *
+ * @param data Where to write it.
+ *
+ * @return 0 on success, -1 if data is NULL.
+ */
+int _memstat(struct MemStats* data) {
+
+    if (data == NULL) {
+        return -1;
+    }
+
+    data->caches = 0;
+
+    while (data->caches < MEMSTAT_CACHES &&
+            kmalloc_cache_stats(data->caches, &data->cache[data->caches]) == 0) {
+        data->caches++;
+    }
+
+    paging_get_stats(&data->paging);
+
+    return 0;
+}
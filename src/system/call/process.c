@@ -1,9 +1,16 @@
 #include "system/call.h"
 #include "system/process/table.h"
 #include "system/scheduler.h"
+#include "system/timer.h"
+#include "system/sync.h"
 
+static void set_nice(struct Process* process, int nice);
+
+/**
+ * The pid of the calling process, which is the same for all of its threads.
+ */
 pid_t _getpid(void) {
-    return scheduler_current()->pid;
+    return scheduler_current()->leader->pid;
 }
 
 pid_t _getppid(void) {
@@ -13,6 +20,10 @@ pid_t _getppid(void) {
 pid_t _run(EntryPoint entryPoint, char* args, int active) {
     struct Process* parent = scheduler_current();
     struct Process* p = process_table_new(entryPoint, args, parent, 0, parent->terminal, active);
+    if (p == NULL) {
+        return -1;
+    }
+
     return p->pid;
 }
 
@@ -20,8 +31,16 @@ void _exit(void) {
     process_table_exit(scheduler_current());
 }
 
-pid_t _wait(void) {
-    return process_table_wait(scheduler_current());
+/**
+ * Wait for a child to finish.
+ *
+ * @param timeout Milliseconds to wait at most, 0 to wait forever.
+ *
+ * @return The pid of the child, 0 on timeout, -1 if there are no children.
+ */
+pid_t _wait(unsigned int timeout) {
+    size_t ticks = timer_ticks((unsigned long long) timeout * NSEC_PER_MSEC);
+    return process_table_wait(scheduler_current(), ticks);
 }
 
 void _kill(pid_t pid) {
@@ -31,3 +50,165 @@ void _kill(pid_t pid) {
     }
 }
 
+/**
+ * Start a thread in the calling process.
+ *
+ * @param start Where it starts, called with entry and arg. It must end with thread_exit.
+ * @param entry The first argument to start.
+ * @param arg The second argument to start.
+ *
+ * @return The id of the thread, -1 if it couldn't be created.
+ */
+pid_t _thread_create(ThreadStart start, void* entry, void* arg) {
+
+    struct Process* t = process_table_new_thread(scheduler_current()->leader, start, entry, arg);
+    if (t == NULL) {
+        return -1;
+    }
+
+    return t->pid;
+}
+
+/**
+ * End the calling thread.
+ *
+ * If it's the main thread, the whole process ends, as with exit.
+ *
+ * @param status What thread_join returns for it.
+ */
+void _thread_exit(int status) {
+
+    struct Process* self = scheduler_current();
+
+    self->exitStatus = status;
+    process_table_exit(self);
+}
+
+/**
+ * Wait for another thread of the calling process to exit, and free it.
+ *
+ * @param tid The thread.
+ * @param status Where to store what it passed to thread_exit, can be NULL.
+ *
+ * @return 0 on success, -1 if tid is not another thread of this process.
+ */
+int _thread_join(pid_t tid, int* status) {
+
+    struct Process* self = scheduler_current();
+    struct Process* t;
+
+    // Looked up again after every wake up, someone else might have joined it
+    while ((t = process_table_get(tid)) != NULL && t != self &&
+            t->leader == self->leader && t != t->leader) {
+
+        if (t->schedule.done) {
+
+            if (status != NULL) {
+                *status = t->exitStatus;
+            }
+
+            process_table_reap_thread(t);
+            return 0;
+        }
+
+        wait_queue_sleep(&self->leader->threadWait);
+    }
+
+    return -1;
+}
+
+/**
+ * Choose the policy a process is scheduled by.
+ *
+ * Processes in the deadline class keep it until they leave, and then go to this one.
+ *
+ * @param pid The process, 0 for the caller.
+ * @param policy One of the SCHED_ policies, or SCHED_DEFAULT to follow the system's.
+ *
+ * @return 0 on success, -1 if there's no such process or policy.
+ */
+int _sched_setscheduler(pid_t pid, int policy) {
+
+    struct Process* process = pid ? process_table_get(pid) : scheduler_current();
+    if (process == NULL || process->schedule.done || policy < SCHED_DEFAULT || policy >= SCHED_POLICIES) {
+        return -1;
+    }
+
+    scheduler_set_policy(process, policy);
+    return 0;
+}
+
+/**
+ * Change the policy of the processes that didn't choose one.
+ *
+ * @param policy One of the SCHED_ policies, or SCHED_DEFAULT to leave it as it is.
+ *
+ * @return The policy before, or -1 if there's no such policy.
+ */
+int _sched_setdefault(int policy) {
+
+    int previous = scheduler_get_default();
+
+    if (policy < SCHED_DEFAULT || policy >= SCHED_POLICIES) {
+        return -1;
+    }
+
+    if (policy != SCHED_DEFAULT && policy != previous) {
+        scheduler_set_default(policy);
+    }
+
+    return previous;
+}
+
+void set_nice(struct Process* process, int nice) {
+
+    if (nice < NICE_MIN) {
+        nice = NICE_MIN;
+    } else if (nice > NICE_MAX) {
+        nice = NICE_MAX;
+    }
+
+    process->schedule.nice = nice;
+    wait_queue_update_priority(process);
+}
+
+/**
+ * Change the nice value of the caller by some amount.
+ *
+ * @param increment Added to it, the result is clamped to NICE_MIN and NICE_MAX.
+ *
+ * @return The new nice value.
+ */
+int _nice(int increment) {
+
+    struct Process* self = scheduler_current();
+
+    // Any more than this would be clamped anyway, and it can't overflow
+    if (increment > PRIORITY_LEVELS) {
+        increment = PRIORITY_LEVELS;
+    } else if (increment < -PRIORITY_LEVELS) {
+        increment = -PRIORITY_LEVELS;
+    }
+
+    set_nice(self, self->schedule.nice + increment);
+    return self->schedule.nice;
+}
+
+/**
+ * Set the nice value of a process.
+ *
+ * @param pid The process, 0 for the caller.
+ * @param nice The new value, clamped to NICE_MIN and NICE_MAX.
+ *
+ * @return 0 on success, -1 if there's no such process.
+ */
+int _setpriority(pid_t pid, int nice) {
+
+    struct Process* process = pid ? process_table_get(pid) : scheduler_current();
+    if (process == NULL || process->schedule.done) {
+        return -1;
+    }
+
+    set_nice(process, nice);
+    return 0;
+}
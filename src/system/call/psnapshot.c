@@ -0,0 +1,106 @@
+#include "system/process/table.h"
+#include "system/call.h"
+#include "system/scheduler.h"
+#include "system/smp.h"
+#include "system/cpu.h"
+#include "system/pmu.h"
+
+static unsigned int generation = 0;
+
+static int process_state(struct Process* process);
+
+int process_state(struct Process* process) {
+
+    if (process->schedule.done) {
+        return PSTATE_ZOMBIE;
+    }
+
+    switch (process->schedule.status) {
+        case StatusRunning:
+            return PSTATE_RUNNING;
+        case StatusReady:
+            return PSTATE_READY;
+        default:
+            return PSTATE_BLOCKED;
+    }
+}
+
+/**
+ * System call that takes a snapshot of every process.
+ *
+ * Counters are cumulative, so a caller gets rates by diffing two snapshots.
+ * The header tells how far apart entries are, so newer kernels can grow
+ * the entry without breaking older callers.
+ *
+ * @param header In: the version the caller understands. Out: the snapshot details.
+ * @param buffer Where the entries are written.
+ * @param length The size of buffer in bytes.
+ *
+ * @return The number of entries written, or -1 if the version is not supported.
+ */
+int _psnapshot(struct ProcessSnapshotHeader* header, void* buffer, size_t length) {
+
+    if (header->version != PSNAPSHOT_VERSION) {
+        return -1;
+    }
+
+    unsigned long long now = rdtsc();
+    size_t count = 0;
+    size_t total = 0;
+    size_t fit = length / sizeof(struct ProcessSnapshot);
+
+    struct Process* process;
+    for (process = process_table_first(); process != NULL; process = process_table_next(process)) {
+
+        total++;
+        if (count == fit) {
+            continue;
+        }
+
+        struct ProcessSnapshot* entry = (struct ProcessSnapshot*) buffer + count;
+
+        entry->pid = process->pid;
+        entry->ppid = process->ppid;
+        entry->priority = process->schedule.priority;
+        entry->nice = process->schedule.nice;
+        entry->state = process_state(process);
+        entry->timeStart = process->timeStart;
+        entry->cycles = process->cycles;
+        struct Cpu* cpu = &smp_cpus[process->cpu];
+        if (process == cpu->curr) {
+            // Other CPUs' counters can't be read from here
+            if (cpu == smp_cpu()) {
+                pmu_account(process);
+            }
+            // It's only charged when switched out
+            entry->cycles += now - cpu->cycles;
+        }
+        entry->waitCycles = process->waitCycles;
+        entry->voluntarySwitches = process->voluntarySwitches;
+        entry->involuntarySwitches = process->involuntarySwitches;
+        entry->instructions = process->perf[PERF_INSTRUCTIONS];
+        entry->cacheMisses = process->perf[PERF_CACHE_MISSES];
+        entry->branchMisses = process->perf[PERF_BRANCH_MISSES];
+
+        entry->tgid = process->leader->pid;
+        entry->deadlineMisses = process->dl.misses;
+        entry->deadlineOverruns = process->dl.overruns;
+        entry->policy = scheduler_policy(process);
+
+        // The stack, and for processes the private area and the page directory
+        entry->memoryPages = process->mm.pagesInStack;
+        if (process->leader == process) {
+            entry->memoryPages += process->mm.space.pages + 1;
+        }
+
+        count++;
+    }
+
+    header->entrySize = sizeof(struct ProcessSnapshot);
+    header->generation = ++generation;
+    header->count = count;
+    header->total = total;
+    header->cycles = now;
+
+    return count;
+}
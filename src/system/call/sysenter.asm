@@ -0,0 +1,22 @@
+EXTERN syscall_enter
+GLOBAL _sysenterEntry
+
+; Entry point for SYSENTER.
+; Processes run in ring 0 too, so there's no stack to switch to, and no
+; SYSEXIT to return with, since it always lands in ring 3. Instead, the
+; caller leaves its stack in ecx and where to come back to in edx. The code
+; goes in eax, and the arguments in ebx, esi and edi.
+_sysenterEntry:
+    mov esp, ecx
+    push edx
+
+    push edi
+    push esi
+    push ebx
+    push eax
+    call syscall_enter
+    add esp, 16
+
+    ; SYSENTER cleared IF, same as an interrupt gate would
+    sti
+    ret
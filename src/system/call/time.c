@@ -1,5 +1,11 @@
 #include "system/call.h"
 #include "drivers/rtc.h"
+#include "system/timer.h"
+#include "system/scheduler.h"
+#include "system/process/table.h"
+#include "library/div64.h"
+#include "library/time.h"
+#include "library/stdlib.h"
 
 
 /**
@@ -19,3 +25,60 @@
 time_t _time(time_t *tp) {
     return getTime(tp);
 }
+
+/**
+ * System call that reads a clock with nanosecond resolution.
+ *
+ * CLOCK_REALTIME has the RTC seconds and no fraction. CLOCK_MONOTONIC
+ * counts from the timer setup, and never goes back.
+ *
+ * @param clock The clock to read.
+ * @param tp Where the time is stored.
+ *
+ * @return 0 on success, -1 if the clock is unknown.
+ */
+int _clock_gettime(int clock, struct timespec* tp) {
+
+    unsigned long long ns;
+
+    switch (clock) {
+        case CLOCK_REALTIME:
+            tp->tv_sec = getTime(NULL);
+            tp->tv_nsec = 0;
+            return 0;
+        case CLOCK_MONOTONIC:
+            ns = timer_nanoseconds();
+            tp->tv_sec = uint64_div64(ns, NSEC_PER_SEC);
+            tp->tv_nsec = uint64_mod64(ns, NSEC_PER_SEC);
+            return 0;
+    }
+
+    return -1;
+}
+
+/**
+ * System call that blocks the caller for the given time.
+ *
+ * Nothing interrupts a sleep in this kernel, so rem always ends up zeroed.
+ *
+ * @param req How long to sleep.
+ * @param rem If not NULL, the time that was left to sleep.
+ *
+ * @return 0 on success, -1 if req is invalid.
+ */
+int _nanosleep(const struct timespec* req, struct timespec* rem) {
+
+    if (req == NULL || req->tv_nsec < 0 || req->tv_nsec >= (long) NSEC_PER_SEC) {
+        return -1;
+    }
+
+    unsigned long long ns = (unsigned long long) req->tv_sec * NSEC_PER_SEC + req->tv_nsec;
+    process_table_sleep(scheduler_current(), timer_ticks(ns));
+
+    if (rem != NULL) {
+        rem->tv_sec = 0;
+        rem->tv_nsec = 0;
+    }
+
+    return 0;
+}
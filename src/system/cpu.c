@@ -0,0 +1,95 @@
+#include "system/cpu.h"
+
+#define EFLAGS_ID (0x1u << 21)
+
+static struct CpuInfo info;
+
+static int has_cpuid(void);
+
+void cpuid(unsigned int leaf, unsigned int* eax, unsigned int* ebx, unsigned int* ecx, unsigned int* edx) {
+    __asm__ __volatile__ ("cpuid"
+            : "=a" (*eax), "=b" (*ebx), "=c" (*ecx), "=d" (*edx)
+            : "0" (leaf), "2" (0)
+    );
+}
+
+/**
+ * CPUID is there if the ID flag in EFLAGS can be toggled.
+ */
+int has_cpuid(void) {
+
+    unsigned int before, after;
+    __asm__ __volatile__ (
+            "pushfl\n\t"
+            "pushfl\n\t"
+            "popl %0\n\t"
+            "movl %0, %1\n\t"
+            "xorl %2, %1\n\t"
+            "pushl %1\n\t"
+            "popfl\n\t"
+            "pushfl\n\t"
+            "popl %1\n\t"
+            "popfl"
+            : "=&r" (before), "=&r" (after)
+            : "i" (EFLAGS_ID)
+    );
+
+    return ((before ^ after) & EFLAGS_ID) != 0;
+}
+
+/**
+ * Identify the CPU and the features it supports.
+ */
+void cpu_detect(void) {
+
+    unsigned int eax, ebx, ecx, edx;
+
+    info.vendor[0] = 0;
+    info.maxLeaf = 0;
+    info.family = info.model = info.stepping = 0;
+    info.features = info.extendedFeatures = 0;
+
+    if (!has_cpuid()) {
+        return;
+    }
+
+    cpuid(0, &eax, &ebx, &ecx, &edx);
+    info.maxLeaf = eax;
+
+    unsigned int* vendor = (unsigned int*) info.vendor;
+    vendor[0] = ebx;
+    vendor[1] = edx;
+    vendor[2] = ecx;
+    info.vendor[12] = 0;
+
+    if (info.maxLeaf >= 1) {
+
+        cpuid(1, &eax, &ebx, &ecx, &edx);
+
+        info.stepping = eax & 0xF;
+        info.model = (eax >> 4) & 0xF;
+        info.family = (eax >> 8) & 0xF;
+        if (info.family == 0xF) {
+            info.family += (eax >> 20) & 0xFF;
+        }
+        if (info.family == 0x6 || info.family >= 0xF) {
+            info.model += ((eax >> 16) & 0xF) << 4;
+        }
+
+        info.features = edx;
+        info.extendedFeatures = ecx;
+
+        // The Pentium Pro says it has SEP, but it doesn't
+        if (info.family == 6 && info.model < 3 && info.stepping < 3) {
+            info.features &= ~CPU_SEP;
+        }
+    }
+}
+
+const struct CpuInfo* cpu_info(void) {
+    return &info;
+}
+
+int cpu_has(unsigned int feature) {
+    return (info.features & feature) == feature;
+}
@@ -0,0 +1,51 @@
+#ifndef __SYSTEM_CPU__
+#define __SYSTEM_CPU__
+
+#include "type.h"
+
+// Feature bits, as reported in EDX by CPUID leaf 1
+#define CPU_FPU (0x1u << 0)
+#define CPU_PSE (0x1u << 3)
+#define CPU_TSC (0x1u << 4)
+#define CPU_MSR (0x1u << 5)
+#define CPU_APIC (0x1u << 9)
+#define CPU_SEP (0x1u << 11)
+#define CPU_PGE (0x1u << 13)
+#define CPU_FXSR (0x1u << 24)
+#define CPU_SSE (0x1u << 25)
+
+struct CpuInfo {
+    char vendor[13];
+    unsigned int maxLeaf;
+    unsigned int family;
+    unsigned int model;
+    unsigned int stepping;
+    unsigned int features;
+    unsigned int extendedFeatures;
+};
+
+void cpu_detect(void);
+
+const struct CpuInfo* cpu_info(void);
+
+int cpu_has(unsigned int feature);
+
+void cpuid(unsigned int leaf, unsigned int* eax, unsigned int* ebx, unsigned int* ecx, unsigned int* edx);
+
+inline static unsigned long long rdtsc(void) {
+    unsigned long long tsc;
+    __asm__ __volatile__ ("rdtsc":"=A"(tsc));
+    return tsc;
+}
+
+inline static unsigned long long rdmsr(unsigned int msr) {
+    unsigned long long value;
+    __asm__ __volatile__ ("rdmsr":"=A"(value):"c"(msr));
+    return value;
+}
+
+inline static void wrmsr(unsigned int msr, unsigned long long value) {
+    __asm__ __volatile__ ("wrmsr"::"c"(msr), "A"(value));
+}
+
+#endif
@@ -0,0 +1,507 @@
+#include "system/deadline.h"
+#include "system/scheduler/class.h"
+#include "system/call.h"
+#include "system/scheduler.h"
+#include "system/process/table.h"
+#include "system/timer.h"
+#include "system/wheel.h"
+#include "system/cpu.h"
+#include "library/div64.h"
+
+// Keeps the products in the wake up check and the conversions within 64 bits
+#define DEADLINE_PERIOD_MAX_NS NSEC_PER_SEC
+
+// Each CPU has its own heap, processes are in the one of process->cpu.
+// The running process is taken out of it, and put back when it's switched out.
+struct DeadlineQueue {
+    // Ordered by absolute deadline, the earliest is at 0
+    struct Process* heap[DEADLINE_MAX_PROCESSES];
+    size_t size;
+    // Processes in the class, and the bandwidth they reserved
+    size_t members;
+    unsigned long long bandwidth;
+};
+
+static struct DeadlineQueue queues[SMP_MAX_CPUS];
+
+static void enqueue(struct Process* process);
+
+static void dequeue(struct Process* process);
+
+static void put_prev(struct Process* process);
+
+static struct Process* pick_next(struct Cpu* cpu);
+
+static void tick(struct Process* process);
+
+static void yield(struct Process* process);
+
+static int before(unsigned long long a, unsigned long long b);
+
+static unsigned long long to_cycles(unsigned long long ns);
+
+static unsigned long long to_ns(unsigned long long cycles);
+
+static void heap_swap(struct DeadlineQueue* queue, size_t i, size_t j);
+
+static void sift_up(struct DeadlineQueue* queue, size_t i);
+
+static void sift_down(struct DeadlineQueue* queue, size_t i);
+
+static void heap_push(struct DeadlineQueue* queue, struct Process* process);
+
+static void heap_remove(struct DeadlineQueue* queue, struct Process* process);
+
+static int preempts(struct Process* process, struct Cpu* cpu);
+
+static void account(struct Process* process);
+
+static void replenish(struct Process* process, unsigned long long now);
+
+static void throttle(struct Process* process);
+
+static void replenish_expired(void* data);
+
+// Runs before every policy, see _sched_setdeadline
+const struct SchedulerClass deadline_class = {
+    "deadline", enqueue, dequeue, put_prev, pick_next, tick, yield
+};
+
+int before(unsigned long long a, unsigned long long b) {
+    return (long long) (a - b) < 0;
+}
+
+unsigned long long to_cycles(unsigned long long ns) {
+    return uint64_div64(ns * timer_cycles_per_second(), NSEC_PER_SEC);
+}
+
+unsigned long long to_ns(unsigned long long cycles) {
+    return uint64_div64(cycles * NSEC_PER_SEC, timer_cycles_per_second());
+}
+
+void heap_swap(struct DeadlineQueue* queue, size_t i, size_t j) {
+
+    struct Process* process = queue->heap[i];
+    queue->heap[i] = queue->heap[j];
+    queue->heap[j] = process;
+
+    queue->heap[i]->dl.heapIndex = i;
+    queue->heap[j]->dl.heapIndex = j;
+}
+
+void sift_up(struct DeadlineQueue* queue, size_t i) {
+
+    while (i > 0) {
+
+        size_t parent = (i - 1) / 2;
+        if (!before(queue->heap[i]->dl.absDeadline, queue->heap[parent]->dl.absDeadline)) {
+            break;
+        }
+
+        heap_swap(queue, i, parent);
+        i = parent;
+    }
+}
+
+void sift_down(struct DeadlineQueue* queue, size_t i) {
+
+    while (1) {
+
+        size_t left = 2 * i + 1;
+        size_t right = left + 1;
+        size_t earliest = i;
+
+        if (left < queue->size &&
+                before(queue->heap[left]->dl.absDeadline, queue->heap[earliest]->dl.absDeadline)) {
+            earliest = left;
+        }
+        if (right < queue->size &&
+                before(queue->heap[right]->dl.absDeadline, queue->heap[earliest]->dl.absDeadline)) {
+            earliest = right;
+        }
+
+        if (earliest == i) {
+            break;
+        }
+
+        heap_swap(queue, i, earliest);
+        i = earliest;
+    }
+}
+
+void heap_push(struct DeadlineQueue* queue, struct Process* process) {
+
+    size_t i = queue->size++;
+
+    queue->heap[i] = process;
+    process->dl.heapIndex = i;
+    process->dl.queued = 1;
+
+    sift_up(queue, i);
+}
+
+void heap_remove(struct DeadlineQueue* queue, struct Process* process) {
+
+    size_t i = process->dl.heapIndex;
+    size_t last = --queue->size;
+
+    process->dl.queued = 0;
+
+    if (i == last) {
+        return;
+    }
+
+    // The last one takes its place, and goes whichever way it has to
+    queue->heap[i] = queue->heap[last];
+    queue->heap[i]->dl.heapIndex = i;
+
+    sift_down(queue, i);
+    sift_up(queue, i);
+}
+
+/**
+ * Whether a process should run instead of what a CPU is running now.
+ *
+ * Deadline processes always preempt the rest, and each other by earliest deadline.
+ */
+int preempts(struct Process* process, struct Cpu* cpu) {
+
+    struct Process* curr = cpu->curr;
+
+    return curr == NULL || curr == cpu->idle || !curr->dl.active ||
+        before(process->dl.absDeadline, curr->dl.absDeadline);
+}
+
+/**
+ * Charge a running process for the cycles since it was last charged.
+ *
+ * @param process The process, which is running.
+ */
+void account(struct Process* process) {
+
+    unsigned long long now = rdtsc();
+
+    process->dl.budget -= (long long) (now - process->dl.execStart);
+    process->dl.execStart = now;
+
+    if (!process->dl.missed && before(process->dl.absDeadline, now)) {
+        process->dl.missed = 1;
+        process->dl.misses++;
+    }
+}
+
+/**
+ * Start the next job, once the budget ran out.
+ *
+ * Whatever it overran is paid from the next periods, pushing the deadline
+ * further away. If it fell too far behind, it just starts over from now.
+ *
+ * @param process The process.
+ * @param now The TSC.
+ */
+void replenish(struct Process* process, unsigned long long now) {
+
+    while (process->dl.budget <= 0) {
+        process->dl.budget += process->dl.runtime;
+        process->dl.absDeadline += process->dl.period;
+    }
+
+    if (before(process->dl.absDeadline, now)) {
+        process->dl.absDeadline = now + process->dl.deadline;
+        process->dl.budget = process->dl.runtime;
+    }
+
+    process->dl.missed = 0;
+}
+
+/**
+ * Keep a process that ran out of budget off the CPU until its next period starts.
+ *
+ * @param process The process, which is runnable but out of the heap.
+ */
+void throttle(struct Process* process) {
+
+    unsigned long long now = rdtsc();
+    unsigned long long next = process->dl.absDeadline - process->dl.deadline + process->dl.period;
+
+    if (before(now, next)) {
+        process->dl.throttled = 1;
+        wheel_add(&process->dl.replenish, timer_ticks(to_ns(next - now)));
+        return;
+    }
+
+    replenish(process, now);
+    heap_push(&queues[process->cpu], process);
+}
+
+void replenish_expired(void* data) {
+
+    struct Process* process = data;
+    struct Cpu* cpu = &smp_cpus[process->cpu];
+
+    process->dl.throttled = 0;
+
+    replenish(process, rdtsc());
+    heap_push(&queues[process->cpu], process);
+
+    if (preempts(process, cpu)) {
+        smp_kick(cpu);
+    }
+}
+
+/**
+ * Give back the bandwidth a process reserved, when it leaves the class.
+ *
+ * @param process The process, which is in the class.
+ */
+void deadline_release(struct Process* process) {
+
+    struct DeadlineQueue* queue = &queues[process->cpu];
+
+    queue->bandwidth -= process->dl.bandwidth;
+    queue->members--;
+    process->dl.bandwidth = 0;
+}
+
+/**
+ * Make a deadline process runnable.
+ *
+ * If it can't finish what's left of its budget by its deadline without
+ * going over its bandwidth, it starts a new job. That's what keeps a process
+ * that sleeps from saving up time and taking it from the others later.
+ *
+ * @param process The process.
+ */
+void enqueue(struct Process* process) {
+
+    struct Cpu* cpu = &smp_cpus[process->cpu];
+    unsigned long long now = rdtsc();
+
+    if (process->dl.runnable) {
+        return;
+    }
+    process->dl.runnable = 1;
+
+    if (process->dl.budget <= 0) {
+        replenish(process, now);
+    }
+
+    if (!before(now, process->dl.absDeadline) ||
+            (unsigned long long) process->dl.budget * process->dl.deadline >
+            (process->dl.absDeadline - now) * process->dl.runtime) {
+        process->dl.absDeadline = now + process->dl.deadline;
+        process->dl.budget = process->dl.runtime;
+        process->dl.missed = 0;
+    }
+
+    // The running process goes back in the heap when it's switched out.
+    // It may have run outside the class, that isn't charged to it.
+    if (process == cpu->curr) {
+        process->dl.execStart = now;
+        return;
+    }
+
+    heap_push(&queues[process->cpu], process);
+
+    if (preempts(process, cpu)) {
+        smp_kick(cpu);
+    }
+}
+
+/**
+ * Take a deadline process out of the heap, because it blocked, exited or left the class.
+ *
+ * @param process The process.
+ */
+void dequeue(struct Process* process) {
+
+    process->dl.runnable = 0;
+
+    if (process->dl.queued) {
+        heap_remove(&queues[process->cpu], process);
+    }
+
+    if (process->dl.throttled) {
+        wheel_cancel(&process->dl.replenish);
+        process->dl.throttled = 0;
+    }
+}
+
+/**
+ * Put a deadline process back, when it's switched out.
+ *
+ * @param process The process that was running.
+ */
+void put_prev(struct Process* process) {
+
+    int yielded = process->dl.yielded;
+
+    account(process);
+    process->dl.yielded = 0;
+
+    if (!process->dl.runnable) {
+        return;
+    }
+
+    if (yielded) {
+        process->dl.budget = 0;
+    } else if (process->dl.budget <= 0) {
+        process->dl.overruns++;
+    }
+
+    if (process->dl.budget <= 0) {
+        throttle(process);
+    } else {
+        heap_push(&queues[process->cpu], process);
+    }
+}
+
+/**
+ * Take the process with the earliest deadline out of a CPU's heap.
+ *
+ * @param cpu This CPU.
+ *
+ * @return The process, or NULL if none is runnable.
+ */
+struct Process* pick_next(struct Cpu* cpu) {
+
+    struct DeadlineQueue* queue = &queues[cpu->index];
+
+    if (queue->size == 0) {
+        return NULL;
+    }
+
+    struct Process* process = queue->heap[0];
+    heap_remove(queue, process);
+    process->dl.execStart = rdtsc();
+
+    return process;
+}
+
+/**
+ * Charge the current deadline process, and switch it out once its budget is gone.
+ *
+ * @param process The process, which is running.
+ */
+void tick(struct Process* process) {
+
+    struct DeadlineQueue* queue = &queues[process->cpu];
+
+    if (!process->dl.runnable) {
+        return;
+    }
+
+    account(process);
+
+    if (process->dl.budget <= 0 ||
+            (queue->size > 0 && before(queue->heap[0]->dl.absDeadline, process->dl.absDeadline))) {
+        smp_cpus[process->cpu].needResched = 1;
+    }
+}
+
+/**
+ * End the current job, the next one starts with the next period.
+ */
+void yield(struct Process* process) {
+    process->dl.yielded = 1;
+}
+
+/**
+ * Number of deadline processes that can run on a CPU, including the current one.
+ */
+size_t deadline_runnable(struct Cpu* cpu) {
+
+    size_t runnable = queues[cpu->index].size;
+
+    if (cpu->curr != NULL && cpu->curr->dl.active && cpu->curr->dl.runnable) {
+        runnable++;
+    }
+
+    return runnable;
+}
+
+/**
+ * System call that moves a process in or out of the deadline class.
+ *
+ * Each period it's guaranteed runtime, done within deadline of the period's
+ * start, as long as it doesn't ask for more. If it does, it's throttled
+ * until the next period. Yielding ends the job, so a periodic process
+ * yields when it's done with each one.
+ *
+ * Reservations can't add up to more than DEADLINE_BANDWIDTH_MAX of the
+ * CPU the process is on, so every admitted process can meet its deadlines.
+ * Runtimes shorter than a tick are refused, that is as fine as it gets.
+ *
+ * @param pid The process, 0 for the caller.
+ * @param params The reservation, in nanoseconds. NULL to leave the class.
+ *
+ * @return 0 on success, DEADLINE_INVALID if there's no such process or
+ *         params don't make sense, DEADLINE_REFUSED if it doesn't fit.
+ */
+int _sched_setdeadline(pid_t pid, const struct DeadlineParams* params) {
+
+    struct Process* process = pid ? process_table_get(pid) : scheduler_current();
+    if (process == NULL || process == smp_cpus[process->cpu].idle || process->schedule.done) {
+        return DEADLINE_INVALID;
+    }
+
+    if (params == NULL) {
+        if (process->dl.active) {
+            deadline_release(process);
+            scheduler_set_deadline(process, 0);
+        }
+        return 0;
+    }
+
+    // Budgets are only enforced on ticks, and replenishing an empty one
+    // never terminates, so anything that rounds to no time is refused
+    if (params->runtime < NSEC_PER_TICK || params->runtime > params->deadline ||
+            params->deadline > params->period || params->period > DEADLINE_PERIOD_MAX_NS) {
+        return DEADLINE_INVALID;
+    }
+
+    unsigned long long runtime = to_cycles(params->runtime);
+    unsigned long long period = to_cycles(params->period);
+    if (runtime == 0 || period == 0) {
+        return DEADLINE_INVALID;
+    }
+
+    struct DeadlineQueue* queue = &queues[process->cpu];
+    unsigned long long bandwidth = uint64_div64(params->runtime << DEADLINE_BANDWIDTH_SHIFT, params->period);
+    unsigned long long others = queue->bandwidth - process->dl.bandwidth;
+
+    if (others + bandwidth > DEADLINE_BANDWIDTH_MAX ||
+            (!process->dl.active && queue->members == DEADLINE_MAX_PROCESSES)) {
+        return DEADLINE_REFUSED;
+    }
+
+    // Taken out while its deadline changes, it's ordered by it
+    int runnable = process->dl.runnable;
+    if (runnable) {
+        dequeue(process);
+    }
+
+    if (!process->dl.active) {
+        queue->members++;
+        wheel_event_init(&process->dl.replenish, replenish_expired, process);
+    }
+
+    queue->bandwidth = others + bandwidth;
+    process->dl.bandwidth = bandwidth;
+    process->dl.runtime = runtime;
+    process->dl.deadline = to_cycles(params->deadline);
+    process->dl.period = period;
+
+    // The first job starts now
+    process->dl.absDeadline = rdtsc() + process->dl.deadline;
+    process->dl.budget = process->dl.runtime;
+    process->dl.missed = 0;
+
+    if (!process->dl.active) {
+        scheduler_set_deadline(process, 1);
+    } else if (runnable) {
+        enqueue(process);
+    }
+
+    return 0;
+}
@@ -0,0 +1,21 @@
+#ifndef __SYSTEM_DEADLINE__
+#define __SYSTEM_DEADLINE__
+
+#include "system/process/process.h"
+#include "system/smp.h"
+#include "type.h"
+
+// Bandwidths are runtime / period, in fixed point with this many fractional bits
+#define DEADLINE_BANDWIDTH_SHIFT 20
+
+// What deadline processes can reserve of each CPU, the rest is left to the policies
+#define DEADLINE_BANDWIDTH_MAX ((95ull << DEADLINE_BANDWIDTH_SHIFT) / 100)
+
+// Deadline processes each CPU can hold
+#define DEADLINE_MAX_PROCESSES 32
+
+void deadline_release(struct Process* process);
+
+size_t deadline_runnable(struct Cpu* cpu);
+
+#endif
@@ -0,0 +1,155 @@
+#include "system/fpu.h"
+#include "system/cpu.h"
+#include "system/slab.h"
+#include "system/scheduler.h"
+#include "system/panic.h"
+
+#define CR0_MP (0x1u << 1)
+#define CR0_EM (0x1u << 2)
+#define CR0_TS (0x1u << 3)
+#define CR0_NE (0x1u << 5)
+
+#define CR4_OSFXSR (0x1u << 9)
+#define CR4_OSXMMEXCPT (0x1u << 10)
+
+// All SSE exceptions masked, round to nearest
+#define MXCSR_DEFAULT 0x1F80
+
+static int fxsr = 0;
+
+static int sse = 0;
+
+static void set_ts(void);
+
+static void save(void* state);
+
+static void restore(void* state);
+
+void set_ts(void) {
+    unsigned int cr0;
+    __asm__ __volatile__ ("mov %%cr0, %0":"=r"(cr0));
+    __asm__ __volatile__ ("mov %0, %%cr0"::"r"(cr0 | CR0_TS));
+}
+
+void save(void* state) {
+    if (fxsr) {
+        __asm__ __volatile__ ("fxsave (%0)"::"r"(state):"memory");
+    } else {
+        __asm__ __volatile__ ("fnsave (%0); fwait"::"r"(state):"memory");
+    }
+}
+
+void restore(void* state) {
+    if (fxsr) {
+        __asm__ __volatile__ ("fxrstor (%0)"::"r"(state):"memory");
+    } else {
+        __asm__ __volatile__ ("frstor (%0)"::"r"(state):"memory");
+    }
+}
+
+/**
+ * Turn on the FPU, and SSE if there's support for it.
+ *
+ * TS is left set, so that the first process to use it traps into fpu_trap.
+ */
+void fpu_init(void) {
+
+    if (!cpu_has(CPU_FPU)) {
+        return;
+    }
+
+    unsigned int cr0;
+    __asm__ __volatile__ ("mov %%cr0, %0":"=r"(cr0));
+    cr0 = (cr0 & ~CR0_EM) | CR0_MP | CR0_NE;
+    __asm__ __volatile__ ("mov %0, %%cr0"::"r"(cr0));
+
+    fxsr = cpu_has(CPU_FXSR);
+    sse = fxsr && cpu_has(CPU_SSE);
+
+    if (fxsr) {
+        unsigned int cr4;
+        __asm__ __volatile__ ("mov %%cr4, %0":"=r"(cr4));
+        cr4 |= CR4_OSFXSR;
+        if (sse) {
+            cr4 |= CR4_OSXMMEXCPT;
+        }
+        __asm__ __volatile__ ("mov %0, %%cr4"::"r"(cr4));
+    }
+
+    __asm__ __volatile__ ("fninit");
+    set_ts();
+}
+
+/**
+ * Arm the lazy switch for the process about to run.
+ *
+ * Nothing is saved here. If next doesn't own the FPU, its first FPU
+ * instruction traps and the state is swapped then.
+ *
+ * @param next The process being switched to.
+ */
+void fpu_switch(struct Process* next) {
+
+    if (next != NULL && next == smp_cpu()->fpuOwner) {
+        __asm__ __volatile__ ("clts");
+    } else {
+        set_ts();
+    }
+}
+
+/**
+ * Device not available handler, hand the FPU over to the current process.
+ */
+void fpu_trap(void) {
+
+    struct Cpu* cpu = smp_cpu();
+    struct Process* current = cpu->curr;
+
+    __asm__ __volatile__ ("clts");
+
+    // Task switches, such as the page fault one, set TS behind our back
+    if (current == cpu->fpuOwner || current == NULL) {
+        return;
+    }
+
+    if (cpu->fpuOwner != NULL) {
+        save(cpu->fpuOwner->fpuState);
+    }
+
+    if (current->fpuState == NULL) {
+
+        // Slab objects are 16 byte aligned, as FXSAVE wants
+        current->fpuState = kmalloc(FPU_STATE_SIZE);
+        if (current->fpuState == NULL) {
+            panic();
+        }
+
+        __asm__ __volatile__ ("fninit");
+        if (sse) {
+            unsigned int mxcsr = MXCSR_DEFAULT;
+            __asm__ __volatile__ ("ldmxcsr %0"::"m"(mxcsr));
+        }
+    } else {
+        restore(current->fpuState);
+    }
+
+    cpu->fpuOwner = current;
+}
+
+/**
+ * Free the FPU state of a process that's done.
+ *
+ * @param process The process.
+ */
+void fpu_release(struct Process* process) {
+
+    // Its state could still be loaded in the last CPU it ran on
+    for (unsigned int i = 0; i < smp_cpu_count; i++) {
+        if (smp_cpus[i].fpuOwner == process) {
+            smp_cpus[i].fpuOwner = NULL;
+        }
+    }
+
+    kfree(process->fpuState);
+    process->fpuState = NULL;
+}
@@ -0,0 +1,17 @@
+#ifndef __SYSTEM_FPU__
+#define __SYSTEM_FPU__
+
+#include "system/process/process.h"
+
+// FXSAVE needs 512 bytes, FNSAVE only 108
+#define FPU_STATE_SIZE 512
+
+void fpu_init(void);
+
+void fpu_switch(struct Process* next);
+
+void fpu_trap(void);
+
+void fpu_release(struct Process* process);
+
+#endif
@@ -0,0 +1,108 @@
+#include "system/call.h"
+#include "system/sync.h"
+#include "system/scheduler.h"
+#include "system/timer.h"
+#include "system/process/table.h"
+
+// Must be a power of two
+#define FUTEX_BUCKETS 64
+
+// Waiters on every futex that hashes to a bucket share its queue, and are told apart by key
+static struct WaitQueue buckets[FUTEX_BUCKETS];
+
+static void* futex_key(int* address);
+
+static struct WaitQueue* bucket_of(void* key);
+
+/**
+ * The physical address of a futex word.
+ *
+ * Virtual addresses in the private area mean something else in each
+ * address space, the frame they're mapped to doesn't.
+ *
+ * @return The key, or NULL if address is misaligned or not mapped.
+ */
+void* futex_key(int* address) {
+
+    if ((size_t) address & (sizeof(int) - 1)) {
+        return NULL;
+    }
+
+    return paging_lookup(process_space(scheduler_current()), address);
+}
+
+struct WaitQueue* bucket_of(void* key) {
+    // Words are aligned, so the low bits carry nothing
+    return &buckets[((size_t) key >> 2) & (FUTEX_BUCKETS - 1)];
+}
+
+/**
+ * System call that sleeps until woken with _futex_wake, if *address still holds value.
+ *
+ * Checking the value and going to sleep happen under the kernel lock, so
+ * a wake that comes after the caller changed the value can't be missed.
+ *
+ * @param address The futex word.
+ * @param value What the caller saw in it.
+ * @param timeout Milliseconds to wait at most, 0 to wait forever.
+ *
+ * @return FUTEX_WOKEN, FUTEX_CHANGED if *address wasn't value,
+ *         FUTEX_TIMEDOUT, or -1 if address is not a valid futex.
+ */
+int _futex_wait(int* address, int value, unsigned int timeout) {
+
+    struct Process* process = scheduler_current();
+    void* key = futex_key(address);
+    if (key == NULL) {
+        return -1;
+    }
+
+    if (*(volatile int*) address != value) {
+        return FUTEX_CHANGED;
+    }
+
+    process_table_timeout(process, timer_ticks((unsigned long long) timeout * NSEC_PER_MSEC));
+
+    process->futexKey = key;
+    wait_queue_sleep(bucket_of(key));
+    process->futexKey = NULL;
+
+    int timedOut = process->schedule.timedOut;
+    process_table_timeout(process, 0);
+
+    return timedOut ? FUTEX_TIMEDOUT : FUTEX_WOKEN;
+}
+
+/**
+ * System call that wakes up processes sleeping on a futex.
+ *
+ * @param address The futex word.
+ * @param count How many to wake up at most.
+ *
+ * @return How many were woken up, or -1 if address is not a valid futex.
+ */
+int _futex_wake(int* address, int count) {
+
+    void* key = futex_key(address);
+    if (key == NULL) {
+        return -1;
+    }
+
+    struct WaitQueue* bucket = bucket_of(key);
+    struct Process* process = bucket->processes.first;
+    int woken = 0;
+
+    while (process != NULL && woken < count) {
+
+        struct Process* next = process->queueNext;
+
+        if (process->futexKey == key) {
+            process_table_unblock(process);
+            woken++;
+        }
+
+        process = next;
+    }
+
+    return woken;
+}
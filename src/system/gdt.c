@@ -1,7 +1,7 @@
 #include "system/gdt.h"
 #include "system/common.h"
-
-extern _initGDT(void*);
+#include "system/smp.h"
+#include "type.h"
 
 #pragma pack(1)
 
@@ -14,14 +14,43 @@ struct SegmentDescriptor {
     char base_h;
 };
 
-struct SegmentDescriptor gdt[5];
+struct TaskState {
+    unsigned short link, link_h;
+    unsigned int esp0;
+    unsigned short ss0, ss0_h;
+    unsigned int esp1;
+    unsigned short ss1, ss1_h;
+    unsigned int esp2;
+    unsigned short ss2, ss2_h;
+    unsigned int cr3, eip, eflags, eax, ecx, edx, ebx, esp, ebp, esi, edi;
+    unsigned short es, es_h, cs, cs_h, ss, ss_h, ds, ds_h, fs, fs_h, gs, gs_h, ldt, ldt_h;
+    unsigned short trap, iomap;
+};
+
+#define GDT_ENTRIES 8
+
+#define TSS_ACCESS 0x89
+#define DATA_ACCESS 0x92
+
+// Every CPU has a table of its own. Selectors are the same in all of them,
+// so the IDT can be shared and still send page faults to the right task.
+struct CpuTables {
+    struct SegmentDescriptor gdt[GDT_ENTRIES];
+
+    // Everything runs on the main task, it only exists so the CPU has somewhere
+    // to save the state of whatever was running when the fault task is called.
+    struct TaskState mainTask;
+    struct TaskState faultTask;
+};
+
+static struct CpuTables tables[SMP_MAX_CPUS];
 
 struct GDTR {
     short limit;
     int base;
 };
 
-static void setupGDTEntry(int num, int base, int limit, short access, short gran) {
+static void setupGDTEntry(struct SegmentDescriptor* gdt, int num, int base, int limit, short access, short gran) {
    gdt[num].base_l      = (base & 0xFFFF);
    gdt[num].base_m      = (base >> 16) & 0xFF;
    gdt[num].base_h      = (base >> 24) & 0xFF;
@@ -31,22 +60,82 @@ static void setupGDTEntry(int num, int base, int limit, short access, short gran
    gdt[num].access      = access;
 }
 
-void setupGDT(void) {
+static void setupTaskEntry(struct SegmentDescriptor* gdt, int num, struct TaskState* task) {
 
-    struct GDTR gdtr;
+    char* raw = (char*) task;
+    for (size_t i = 0; i < sizeof(struct TaskState); i++) {
+        raw[i] = 0;
+    }
+
+    // No I/O permission bitmap
+    task->iomap = sizeof(struct TaskState);
+
+    setupGDTEntry(gdt, num, (int) task, sizeof(struct TaskState) - 1, TSS_ACCESS, 0);
+}
+
+/**
+ * Load the GDT of a CPU, and point FS to its struct Cpu.
+ *
+ * Called by every CPU on itself, with interrupts disabled.
+ *
+ * @param cpu The CPU running this.
+ */
+void setupGDT(struct Cpu* cpu) {
 
-    disableInterrupts();
+    struct GDTR gdtr;
+    struct SegmentDescriptor* gdt = tables[cpu->index].gdt;
 
-    setupGDTEntry(0, 0, 0, 0, 0);
-    setupGDTEntry(1, 0, 0x000FFFFF, 0x9A, 0xC0);
-    setupGDTEntry(2, 0, 0x000FFFFF, 0x92, 0xC0);
-    setupGDTEntry(3, 0, 0x000FFFFF, 0xFA, 0xC0);
-    setupGDTEntry(4, 0, 0x000FFFFF, 0xF2, 0xC0);
+    setupGDTEntry(gdt, 0, 0, 0, 0, 0);
+    setupGDTEntry(gdt, 1, 0, 0x000FFFFF, 0x9A, 0xC0);
+    setupGDTEntry(gdt, 2, 0, 0x000FFFFF, 0x92, 0xC0);
+    setupGDTEntry(gdt, 3, 0, 0x000FFFFF, 0xFA, 0xC0);
+    setupGDTEntry(gdt, 4, 0, 0x000FFFFF, 0xF2, 0xC0);
+    setupTaskEntry(gdt, MAIN_TASK_SELECTOR / sizeof(struct SegmentDescriptor), &tables[cpu->index].mainTask);
+    setupTaskEntry(gdt, FAULT_TASK_SELECTOR / sizeof(struct SegmentDescriptor), &tables[cpu->index].faultTask);
+    setupGDTEntry(gdt, CPU_SELECTOR / sizeof(struct SegmentDescriptor), (int) cpu, sizeof(struct Cpu) - 1, DATA_ACCESS, 0x40);
 
-    gdtr.limit = 5 * sizeof(struct SegmentDescriptor) - 1;
-    gdtr.base = (int)&gdt;
+    gdtr.limit = GDT_ENTRIES * sizeof(struct SegmentDescriptor) - 1;
+    gdtr.base = (int) gdt;
 
     __asm__ volatile("lgdt (%%eax)"::"A"(&gdtr):);
-    enableInterrupts();
+    __asm__ volatile("ltr %%ax"::"a"(MAIN_TASK_SELECTOR));
+    __asm__ volatile("mov %%ax, %%fs"::"a"(CPU_SELECTOR));
+}
+
+/**
+ * Setup the task the page fault gate switches to, for the CPU running this.
+ *
+ * Faults on a stack can't be handled on that same stack, so they get a task
+ * of their own, which returns to the main task with iret.
+ *
+ * @param entry The code to run in the task, it will be resumed after its iret.
+ * @param stackTop The top of the stack for the task.
+ * @param cr3 The page directory the task runs with.
+ */
+void setupFaultTask(void (*entry)(void), void* stackTop, unsigned int cr3) {
+
+    struct TaskState* faultTask = &tables[smp_cpu()->index].faultTask;
+
+    faultTask->eip = (unsigned int) entry;
+    faultTask->esp = (unsigned int) stackTop;
+    faultTask->eflags = 0x2;
+    faultTask->cr3 = cr3;
+
+    faultTask->cs = KERNEL_CODE_SELECTOR;
+    faultTask->ss = faultTask->ds = faultTask->es = faultTask->gs = KERNEL_DATA_SELECTOR;
+    faultTask->fs = CPU_SELECTOR;
+
+    setTaskDirectory(cr3);
+}
+
+/**
+ * Set the page directory restored when going back to the main task.
+ *
+ * The CPU never saves CR3 on a task switch, so this has to be kept up to date.
+ *
+ * @param cr3 The page directory in use by the CPU running this.
+ */
+void setTaskDirectory(unsigned int cr3) {
+    tables[smp_cpu()->index].mainTask.cr3 = cr3;
 }
 
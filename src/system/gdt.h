@@ -1,6 +1,21 @@
 #ifndef __SYSTEM_GDT__
 #define __SYSTEM_GDT__
 
-void setupGDT(void);
+#define KERNEL_CODE_SELECTOR 0x08
+#define KERNEL_DATA_SELECTOR 0x10
+
+#define MAIN_TASK_SELECTOR 0x28
+#define FAULT_TASK_SELECTOR 0x30
+
+// Its base is the struct Cpu of the CPU, and it's kept in FS
+#define CPU_SELECTOR 0x38
+
+struct Cpu;
+
+void setupGDT(struct Cpu* cpu);
+
+void setupFaultTask(void (*entry)(void), void* stackTop, unsigned int cr3);
+
+void setTaskDirectory(unsigned int cr3);
 
 #endif
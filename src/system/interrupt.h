@@ -2,4 +2,6 @@
 #define _system_interrupt_header_
 
 void setupIDT(void);
+
+void loadIDT(void);
 #endif
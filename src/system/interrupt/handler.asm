@@ -1,5 +1,5 @@
-EXTERN  int08, int09, interruptDispatcher, writeScreen
-GLOBAL _interruptEnd, _l
+EXTERN  int08, int09, interruptDispatcher, writeScreen, pageFault
+GLOBAL _interruptEnd, _l, _pageFaultTask, _spuriousHandler
 
 ; Defines a macro that takes as an argument the interrupt number.
 ; Calls that interrupt.
@@ -8,10 +8,10 @@ GLOBAL _interruptEnd, _l
     pushad
 
     ; Set up the handler execution context
+    ; FS is left alone, it points to the CPU's own data
     mov ax, 0x10    
     mov ds, ax 
     mov es, ax
-    mov fs, ax
     mov gs, ax
     mov ss, ax
 
@@ -20,7 +20,6 @@ GLOBAL _interruptEnd, _l
     mov ax, 0x10
     mov ds, ax 
     mov es, ax
-    mov fs, ax
     mov gs, ax
     mov ss, ax
 
@@ -37,7 +36,6 @@ _interruptEnd:
     mov ax, 0x10
     mov ds, ax
     mov es, ax
-    mov fs, ax
     mov gs, ax
     mov ss, ax
 
@@ -45,6 +43,19 @@ _interruptEnd:
 _l:
     jmp _l
 
+; Spurious interrupts from the local APIC must not be acknowledged.
+_spuriousHandler:
+    iret
+
+; Entry point of the page fault task.
+; The task gate leaves the error code on this task's stack, and the iret
+; switches back to the faulting task, so the next fault resumes after it.
+_pageFaultTask:
+    call pageFault
+    add esp, 4
+    iret
+    jmp _pageFaultTask
+
 
 ; Defines a macro that takes as an argument the interrupt number.
 ; Uses the CALLER macro to call the corresponding interrupt.
@@ -79,6 +90,12 @@ ISR 80, interruptDispatcher
 ISR 20, interruptDispatcher
 ISR 21, interruptDispatcher
 
+; Local APIC timer
+ISR 30, interruptDispatcher
+
+; Reschedule request from another CPU
+ISR 31, interruptDispatcher
+
 ; Definition of exceptions Handlers
 ERR_ISR 00, interruptDispatcher
 ERR_ISR 01, interruptDispatcher
@@ -94,7 +111,6 @@ ERR_ISR 0A, interruptDispatcher
 ERR_ISR 0B, interruptDispatcher
 ERR_ISR 0C, interruptDispatcher
 ERR_ISR 0D, interruptDispatcher
-ERR_ISR 0E, interruptDispatcher
 ERR_ISR 0F, interruptDispatcher
 ERR_ISR 10, interruptDispatcher
 ERR_ISR 11, interruptDispatcher
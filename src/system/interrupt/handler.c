@@ -4,8 +4,12 @@
 #include "system/io.h"
 #include "system/common.h"
 #include "system/interrupt/handler.h"
-#include "system/call/codes.h"
 #include "system/scheduler.h"
+#include "system/timer.h"
+#include "system/apic.h"
+#include "system/fpu.h"
+#include "system/profile.h"
+#include "system/smp.h"
 
 typedef struct {
     int edi, esi, ebp, esp, ebx, edx, ecx, eax;
@@ -15,8 +19,6 @@ typedef struct {
 
 typedef void (*interruptHandler)(registers* regs);
 
-static int intNum;
-
 static interruptHandler table[256];
 
 #define     register(X)         table[0x##X] = &int##X
@@ -35,10 +37,14 @@ static const char* exceptionTable[] = { "Divide by zero", "Debugger", "NMI", "Br
                                          "Intel Reserved", "Math Fault", "Aligment Check",
                                          "Machine Check", "Floating-Point Exception"};
 
+static void int07(registers* regs);
 static void int20(registers* regs);
 static void int21(registers* regs);
+static void int30(registers* regs);
+static void int31(registers* regs);
 static void int80(registers* regs);
 static void exceptionHandler(registers* regs);
+static void signalPIC(int intNum);
 void interruptDispatcher(registers regs);
 
 
@@ -49,6 +55,7 @@ void interruptDispatcher(registers regs);
  *  @param regs Pointer to struct containing micro's registers.
  */
 void int20(registers* regs) {
+    profile_sample(regs->eip);
     timerTick();
 }
 
@@ -61,6 +68,45 @@ void int21(registers* regs ) {
     keyboard_read();
 }
 
+/**
+ * Exception 07h, device not available. Loads the FPU state of the current process.
+ *
+ *  @param regs Pointer to struct containing micro's registers.
+ */
+void int07(registers* regs) {
+
+    (void) regs;
+
+    fpu_trap();
+}
+
+/**
+ * Interrupt 30h. Handles the local APIC timer, which replaces IRQ0 when available.
+ *
+ * Every CPU has its own. While profiling they go faster, and only some are ticks.
+ *
+ *  @param regs Pointer to struct containing micro's registers.
+ */
+void int30(registers* regs) {
+    profile_sample(regs->eip);
+    if (timer_lapic_tick()) {
+        timerTick();
+    }
+    lapic_eoi();
+}
+
+/**
+ * Interrupt 31h. Another CPU wants this one to reschedule, which happens on the way out.
+ *
+ *  @param regs Pointer to struct containing micro's registers.
+ */
+void int31(registers* regs) {
+
+    (void) regs;
+
+    lapic_eoi();
+}
+
 /**
  * Register interrupts in the handler table.
  *
@@ -70,8 +116,11 @@ void setInterruptHandlerTable(void) {
     for (i = 0;i < 32;i++) {
         table[i] = &exceptionHandler;
     }
+    register(07);
     register(20);
     register(21);
+    register(30);
+    register(31);
 
     register(80);
 }
@@ -87,17 +136,25 @@ void setInterruptHandlerTable(void) {
  */
 void interruptDispatcher(registers regs) {
 
-    // So, since the stack might be changed by a context change
-    // We need access to this number some other way
-    // And since the kernel itself is not preemptive, storing it like this is safe.
-    intNum = regs.intNum;
+    smp_lock_kernel();
+
+    timer_resume(regs.intNum);
     (*table[regs.intNum])(&regs);
 
-    scheduler_do();
-    signalPIC();
+    // Acknowledge it before switching, the process we switch to may resume
+    // anywhere, and this frame only gets back here whenever it's picked again
+    signalPIC(regs.intNum);
+    scheduler_preempt();
+
+    smp_unlock_kernel();
 }
 
-void signalPIC(void) {
+/**
+ * Tell the PICs an interrupt they raised has been handled.
+ *
+ *  @param intNum The interrupt number.
+ */
+void signalPIC(int intNum) {
 
     if (intNum >= PIC_MIN_INTNUM && intNum < PIC_MIN_INTNUM + PIC_IRQS) {
         if (intNum - PIC_MIN_INTNUM >= 8) {
@@ -116,49 +173,7 @@ void signalPIC(void) {
  *  @param regs Pointer to struct containing micro's registers.
  */
 void int80(registers* regs) {
-
-    switch (regs->eax) {
-
-        case _SYS_READ:
-            regs->eax = _read((unsigned int)regs->ebx, (char*)regs->ecx, (size_t)regs->edx);
-            break;
-        case _SYS_WRITE:
-            regs->eax = _write((unsigned int)regs->ebx, (const char*)regs->ecx, (size_t)regs->edx);
-            break;
-        case _SYS_TIME:
-            regs->eax = _time(regs->ebx);
-            break;
-        case _SYS_IOCTL:
-            regs->eax = _ioctl(regs->ebx, regs->ecx, (void*)regs->edx);
-            break;
-        case _SYS_TICKS:
-            regs->eax = _getTicksSinceStart();
-            break;
-        case _SYS_YIELD:
-            // This just makes sure we call the scheduler again, for now
-            break;
-        case _SYS_EXIT:
-            _exit();
-            break;
-        case _SYS_GETPID:
-            regs->eax = _getpid();
-            break;
-        case _SYS_GETPPID:
-            regs->eax = _getppid();
-            break;
-        case _SYS_RUN:
-            regs->eax = _run((void(*)(char*)) regs->ebx, (char*) regs->ecx, regs->edx);
-            break;
-        case _SYS_WAIT:
-            regs->eax = _wait();
-            break;
-        case _SYS_KILL:
-            _kill((pid_t) regs->ebx);
-            break;
-        case _SYS_PINFO:
-            regs->eax = _pinfo(regs->ebx, (size_t)regs->ecx);
-            break;
-    }
+    regs->eax = syscall_dispatch(regs->eax, regs->ebx, regs->ecx, regs->edx);
 }
 
 /**
@@ -167,6 +182,15 @@ void int80(registers* regs) {
  *  @param regs Pointer to struct containing micro's registers.
  */
 void exceptionHandler(registers* regs){
+    showException(regs->intNum);
+}
+
+/**
+ * Show an unhandled exception on screen and stop.
+ *
+ *  @param exceptionNum The number of the exception.
+ */
+void showException(int exceptionNum) {
     char* screen = (char*) 0xb8000;
     int i = 0;
     const char* message = "Unhandled CPU exception: ";
@@ -184,17 +208,17 @@ void exceptionHandler(registers* regs){
         screen++;
     }
 
-    *screen = (regs->intNum/10)+'0';
+    *screen = (exceptionNum/10)+'0';
     screen += 2;
-    *screen = (regs->intNum%10)+'0';
+    *screen = (exceptionNum%10)+'0';
     screen += 2;
     *screen = ' ';
 
     const char* exception;
-    if (regs->intNum > IN_USE_EXCEPTIONS ){
+    if (exceptionNum > IN_USE_EXCEPTIONS ){
         exception = "Reserved for future use";
     } else {
-        exception = exceptionTable[regs->intNum];
+        exception = exceptionTable[exceptionNum];
     }
     i = 0;
     while ( exception[i] != '\0') {
@@ -205,4 +229,3 @@ void exceptionHandler(registers* regs){
     disableInterrupts();
     halt();
 }
-
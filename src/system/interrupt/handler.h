@@ -3,6 +3,6 @@
 
 void setInterruptHandlerTable(void);
 
-void signalPIC(void);
+void showException(int exceptionNum);
 
 #endif
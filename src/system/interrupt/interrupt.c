@@ -3,7 +3,11 @@
 #include "system/io.h"
 #include "system/call.h"
 #include "system/interrupt/handler.h"
+#include "system/gdt.h"
+#include "system/timer.h"
+#include "system/apic.h"
 #include "system/call/codes.h"
+#include "system/smp.h"
 
 /* Flags para derechos de acceso de los segmentos */
 #define ACS_PRESENT         0x80            /* segmento presente en memoria */
@@ -14,6 +18,8 @@
 #define ACS_IDT             ACS_DSEG
 #define ACS_INT_386 	    0x0E		/* Interrupt GATE 32 bits */
 #define ACS_INT             (ACS_PRESENT | ACS_INT_386 )
+#define ACS_TASK_GATE       0x05        /* Task GATE */
+#define ACS_TASK            (ACS_PRESENT | ACS_TASK_GATE )
 
 
 #define ACS_CODE            (ACS_PRESENT | ACS_CSEG | ACS_READ)
@@ -85,7 +91,6 @@ void _int0AHandler(void);
 void _int0BHandler(void);
 void _int0CHandler(void);
 void _int0DHandler(void);
-void _int0EHandler(void);
 void _int0FHandler(void);
 void _int10Handler(void);
 void _int11Handler(void);
@@ -106,7 +111,10 @@ void _int1FHandler(void);
 
 void _int20Handler(void);
 void _int21Handler(void);
+void _int30Handler(void);
+void _int31Handler(void);
 void _int80Handler(void);
+void _spuriousHandler(void);
 
 
 
@@ -116,8 +124,6 @@ void _int80Handler(void);
  * Remaps the PIC, and loads the interrput and exceptions handlers.
  */
 void setupIDT(void) {
-    // We don't actually have to keep this in memory, so it's safe to have it as a local.
-    InterruptDescriptorTableRegister idtr;
 
     // Disabling interrupts to make sure we're in absolute control.
     _cli();
@@ -126,6 +132,9 @@ void setupIDT(void) {
     setIdtEntry(idt, 0x80, 0x08, (dword)&_int80Handler, ACS_INT);
     setIdtEntry(idt, 0x20, 0x08, (dword)&_int20Handler, ACS_INT);
     setIdtEntry(idt, 0x21, 0x08, (dword)&_int21Handler, ACS_INT);
+    setIdtEntry(idt, TIMER_VECTOR, 0x08, (dword)&_int30Handler, ACS_INT);
+    setIdtEntry(idt, RESCHED_VECTOR, 0x08, (dword)&_int31Handler, ACS_INT);
+    setIdtEntry(idt, SPURIOUS_VECTOR, 0x08, (dword)&_spuriousHandler, ACS_INT);
 
     setIdtEntry(idt, 0x00, 0x08, (dword)&_int00Handler, ACS_INT);
     setIdtEntry(idt, 0x01, 0x08, (dword)&_int01Handler, ACS_INT);
@@ -141,7 +150,8 @@ void setupIDT(void) {
     setIdtEntry(idt, 0x0B, 0x08, (dword)&_int0BHandler, ACS_INT);
     setIdtEntry(idt, 0x0C, 0x08, (dword)&_int0CHandler, ACS_INT);
     setIdtEntry(idt, 0x0D, 0x08, (dword)&_int0DHandler, ACS_INT);
-    setIdtEntry(idt, 0x0E, 0x08, (dword)&_int0EHandler, ACS_INT);
+    // Page faults switch to a task of their own, so they can be handled even if the stack faulted
+    setIdtEntry(idt, 0x0E, FAULT_TASK_SELECTOR, 0, ACS_TASK);
     setIdtEntry(idt, 0x0F, 0x08, (dword)&_int0FHandler, ACS_INT);
     setIdtEntry(idt, 0x10, 0x08, (dword)&_int10Handler, ACS_INT);
     setIdtEntry(idt, 0x11, 0x08, (dword)&_int11Handler, ACS_INT);
@@ -160,10 +170,7 @@ void setupIDT(void) {
     setIdtEntry(idt, 0x1E, 0x08, (dword)&_int1EHandler, ACS_INT);
     setIdtEntry(idt, 0x1F, 0x08, (dword)&_int1FHandler, ACS_INT);
 
-    idtr.base = (dword) &idt;
-    idtr.limit = sizeof(idt) - 1;
-
-    _lidt(&idtr);
+    loadIDT();
 
     setInterruptHandlerTable();
 
@@ -176,6 +183,21 @@ void setupIDT(void) {
 }
 
 
+/**
+ * Load the IDT on the CPU running this.
+ *
+ * The table is shared, so the other CPUs only need this once setupIDT is done.
+ */
+void loadIDT(void) {
+    // We don't actually have to keep this in memory, so it's safe to have it as a local.
+    InterruptDescriptorTableRegister idtr;
+
+    idtr.base = (dword) &idt;
+    idtr.limit = sizeof(idt) - 1;
+
+    _lidt(&idtr);
+}
+
 /**
  * Loads an interrupt in the IDT.
  *
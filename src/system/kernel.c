@@ -4,16 +4,29 @@
 #include "library/string.h"
 #include "drivers/tty/tty.h"
 #include "system/mm.h"
+#include "system/paging.h"
+#include "system/cpu.h"
+#include "system/call.h"
+#include "system/fpu.h"
+#include "system/pmu.h"
+#include "system/apic.h"
+#include "system/timer.h"
 #include "system/common.h"
 #include "system/gdt.h"
+#include "system/smp.h"
 #include "system/process/table.h"
+#include "system/scheduler.h"
 #include "drivers/ata.h"
 
 void kmain(struct multiboot_info* info, unsigned int magic);
 
 static void idle(char* unused) {
     while (1) {
-        yield();
+        if (scheduler_runnable() > 1) {
+            yield();
+        } else {
+            timer_idle();
+        }
     }
 }
 
@@ -22,9 +35,15 @@ static void idle(char* unused) {
  */
 void kmain(struct multiboot_info* info, unsigned int magic) {
 
-    setupGDT();
+    setupGDT(&smp_cpus[0]);
     setupIDT();
 
+    // Paging needs to know whether there's support for large pages
+    cpu_detect();
+    fpu_init();
+    pmu_init();
+    syscall_init();
+
     FILE files[3];
     for (int i = 0; i < 3; i++) {
         files[i].fd = i;
@@ -37,11 +56,15 @@ void kmain(struct multiboot_info* info, unsigned int magic) {
     stderr = &files[2];
 
     initMemoryMap(info);
+    paging_init();
+    lapic_init();
+    timer_init();
     ata_init(info);
 
     disableInterrupts();
     struct Process* idleProcess = process_table_new(idle, NULL, NULL, 1, NO_TERMINAL, 0);
     struct Process* shellProcess = process_table_new(tty_run, NULL, idleProcess, 1, NO_TERMINAL, 0);
+    smp_init(idle);
     enableInterrupts();
 
     while (1) {}
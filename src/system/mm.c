@@ -12,24 +12,53 @@ struct MemoryMapEntry {
     unsigned int type;
 };
 
-#define MAPPABLE_PAGES (1024 * 1024u)
+// Only the lower 2 GiB are used, the virtual addresses above that are taken by the kernel (see paging.h)
+#define MAPPABLE_PAGES (512 * 1024u)
 
 #define UNUSABLE_PAGES 1024u
 #define MEMORY_START (UNUSABLE_PAGES * PAGE_SIZE)
 
-#define USABLE_PAGES (MAPPABLE_PAGES - UNUSABLE_PAGES)
 
+// Blocks go from a single page up to 2^MAX_ORDER pages (4 MiB)
+#define MAX_ORDER 10
 
-#define PAGES_PER_ENTRY ((unsigned int) sizeof(int) * 8)
-#define ENTRIES_IN_MAP ((USABLE_PAGES / PAGES_PER_ENTRY) + 1)
+#define FREE_BLOCK 0x80
 
-int* pageMap;
+/**
+ * Free blocks are linked through their first page.
+ */
+struct FreeBlock {
+    struct FreeBlock* prev;
+    struct FreeBlock* next;
+};
+
+// One byte per page, FREE_BLOCK | order for the head of a free block, 0 otherwise
+static unsigned char* pageMap;
+
+static size_t mappedPages = 0;
+
+static struct FreeBlock* freeLists[MAX_ORDER + 1];
+
+// Bit n is set when freeLists[n] is not empty
+static unsigned int freeOrders = 0;
+
+static size_t freePageCount = 0;
+
+inline static struct FreeBlock* blockAt(size_t index);
+
+inline static size_t indexOf(void* page);
+
+inline static size_t orderFor(size_t pages);
+
+static void pushBlock(size_t index, size_t order);
+
+static void removeBlock(size_t index, size_t order);
 
-inline static void setPage(int page);
+static void freeBlock(size_t index, size_t order);
 
-inline static void unsetPage(int page);
+static void freeRange(size_t index, size_t pages);
 
-inline static int isPageSet(int page);
+static size_t lastUsablePage(struct multiboot_info* info);
 
 static void initPages(struct multiboot_info* info);
 
@@ -45,10 +74,37 @@ void initMemoryMap(struct multiboot_info* info) {
     }
 }
 
+size_t lastUsablePage(struct multiboot_info* info) {
+
+    size_t last = UNUSABLE_PAGES;
+
+    struct MemoryMapEntry* entry = (struct MemoryMapEntry*) info->mmap_addr;
+    while ((size_t) entry < info->mmap_addr + info->mmap_length) {
+
+        size_t end = entry->base_addr_low + entry->length_low;
+        if (!entry->base_addr_high && end && entry->type == 1) {
+
+            size_t endPage = end / PAGE_SIZE;
+            if (endPage > MAPPABLE_PAGES || end < entry->base_addr_low) {
+                endPage = MAPPABLE_PAGES;
+            }
+
+            if (endPage > last) {
+                last = endPage;
+            }
+        }
+
+        entry = (struct MemoryMapEntry*) ((char*) entry + entry->size + sizeof(unsigned int));
+    }
+
+    return last;
+}
+
 void initPages(struct multiboot_info* info) {
 
-    size_t totalMem = 0;
-    size_t usablePages = 0;
+    for (size_t order = 0; order <= MAX_ORDER; order++) {
+        freeLists[order] = NULL;
+    }
 
     struct MemoryMapEntry* entry = (struct MemoryMapEntry*) info->mmap_addr;
     while ((size_t) entry < info->mmap_addr + info->mmap_length) {
@@ -70,17 +126,14 @@ void initPages(struct multiboot_info* info) {
                     firstPage++;
                 }
 
-                size_t alignedLength = entry->length_low - startOffset;
-                size_t pages = alignedLength / PAGE_SIZE;
-
-                for (size_t page = firstPage; page < firstPage + pages; page++) {
-                    if (page < MAPPABLE_PAGES) {
-                        unsetPage(page);
-                    }
+                size_t lastPage = end / PAGE_SIZE;
+                if (lastPage > UNUSABLE_PAGES + mappedPages || end < start) {
+                    lastPage = UNUSABLE_PAGES + mappedPages;
                 }
 
-                totalMem += pages * PAGE_SIZE;
-                usablePages += pages;
+                if (lastPage > firstPage) {
+                    freeRange(firstPage - UNUSABLE_PAGES, lastPage - firstPage);
+                }
             }
         }
 
@@ -90,7 +143,8 @@ void initPages(struct multiboot_info* info) {
 
 void reservePageMap(struct multiboot_info* info) {
 
-    size_t mapSize = sizeof(int) * ENTRIES_IN_MAP;
+    mappedPages = lastUsablePage(info) - UNUSABLE_PAGES;
+    size_t mapSize = mappedPages;
 
     struct MemoryMapEntry* entry = (struct MemoryMapEntry*) info->mmap_addr;
     while ((size_t) entry < info->mmap_addr + info->mmap_length) {
@@ -102,11 +156,11 @@ void reservePageMap(struct multiboot_info* info) {
 
                 if (entry->base_addr_low < end - mapSize) {
                     if (end > MEMORY_START) {
-                        pageMap = (int*) (3 * 1024 * 1024u);
+                        pageMap = (unsigned char*) (3 * 1024 * 1024u);
                     } else {
-                        pageMap = (int*) (end - mapSize);
+                        pageMap = (unsigned char*) (end - mapSize);
                     }
-                    for (size_t i = 0; i < ENTRIES_IN_MAP; i++) {
+                    for (size_t i = 0; i < mapSize; i++) {
                         pageMap[i] = 0;
                     }
 
@@ -121,38 +175,102 @@ void reservePageMap(struct multiboot_info* info) {
     panic();
 }
 
-void setPage(int page) {
-    page -= UNUSABLE_PAGES;
-    pageMap[page / PAGES_PER_ENTRY] &= -1 ^ (0x1 << (page % PAGES_PER_ENTRY));
+struct FreeBlock* blockAt(size_t index) {
+    return (struct FreeBlock*) ((index + UNUSABLE_PAGES) * PAGE_SIZE);
 }
 
-void unsetPage(int page) {
-    page -= UNUSABLE_PAGES;
-    pageMap[page / PAGES_PER_ENTRY] |= 0x1 << (page % PAGES_PER_ENTRY);
+size_t indexOf(void* page) {
+    return ((size_t) page) / PAGE_SIZE - UNUSABLE_PAGES;
 }
 
-int isPageSet(int page) {
-    page -= UNUSABLE_PAGES;
-    return !(pageMap[page / PAGES_PER_ENTRY] & (0x1 << (page % PAGES_PER_ENTRY)));
+size_t orderFor(size_t pages) {
+
+    if (pages <= 1) {
+        return 0;
+    }
+
+    return 32 - __builtin_clz(pages - 1);
 }
 
-void* allocPage(void) {
+void pushBlock(size_t index, size_t order) {
 
-    for (size_t i = 0; i < ENTRIES_IN_MAP; i++) {
+    struct FreeBlock* block = blockAt(index);
 
-        if (pageMap[i]) {
+    block->prev = NULL;
+    block->next = freeLists[order];
+    if (block->next) {
+        block->next->prev = block;
+    }
 
-            size_t start = i * PAGES_PER_ENTRY + UNUSABLE_PAGES;
-            for (size_t offset = 0; offset < PAGES_PER_ENTRY; offset++) {
+    freeLists[order] = block;
+    freeOrders |= 0x1 << order;
+    pageMap[index] = FREE_BLOCK | order;
+}
 
-                if (isPageSet(offset + start)) {
-                    return (void*)((start + offset) * PAGE_SIZE);
-                }
-            }
+void removeBlock(size_t index, size_t order) {
+
+    struct FreeBlock* block = blockAt(index);
+
+    if (block->prev) {
+        block->prev->next = block->next;
+    } else {
+        freeLists[order] = block->next;
+        if (block->next == NULL) {
+            freeOrders &= ~(0x1 << order);
+        }
+    }
+
+    if (block->next) {
+        block->next->prev = block->prev;
+    }
+
+    pageMap[index] = 0;
+}
+
+void freeBlock(size_t index, size_t order) {
+
+    freePageCount += 1 << order;
+
+    // Merge with the buddy for as long as it's free and of the same size
+    while (order < MAX_ORDER) {
+
+        size_t buddy = index ^ (0x1 << order);
+        if (buddy >= mappedPages || pageMap[buddy] != (FREE_BLOCK | order)) {
+            break;
+        }
+
+        removeBlock(buddy, order);
+        if (buddy < index) {
+            index = buddy;
         }
+        order++;
     }
 
-    return NULL;
+    pushBlock(index, order);
+}
+
+void freeRange(size_t index, size_t pages) {
+
+    size_t end = index + pages;
+    while (index < end) {
+
+        // Take the biggest block that's both aligned and fits in what's left
+        size_t order = index ? __builtin_ctz(index) : MAX_ORDER;
+        if (order > MAX_ORDER) {
+            order = MAX_ORDER;
+        }
+
+        while (index + (0x1 << order) > end) {
+            order--;
+        }
+
+        freeBlock(index, order);
+        index += 0x1 << order;
+    }
+}
+
+void* allocPage(void) {
+    return allocPages(1);
 }
 
 void* kalloc(size_t size) {
@@ -170,58 +288,50 @@ void* allocPages(size_t pages) {
         return NULL;
     }
 
-    size_t start;
-    for (size_t i = 0; i < ENTRIES_IN_MAP; i++) {
-        if (pageMap[i]) {
-
-            start = i * PAGES_PER_ENTRY + UNUSABLE_PAGES;
-
-            size_t consecutive = 0;
-            size_t offset;
-            for (offset = 0;; offset++) {
-                if (isPageSet(start + offset)) {
-                    consecutive = 0;
-                } else {
-                    consecutive++;
-                    if (consecutive == pages) {
-                        break;
-                    }
-                }
-
-                if (((offset + 1) % PAGES_PER_ENTRY) == 0) {
-                    if (consecutive != 0 && i + 1 < ENTRIES_IN_MAP && pageMap[i+1]) {
-                        i++;
-                    } else {
-                        break;
-                    }
-                }
-            }
-
-            if (consecutive == pages) {
-                start += offset - pages + 1;
-                break;
-            }
-        }
-
-        start = 0;
+    size_t order = orderFor(pages);
+    if (order > MAX_ORDER) {
+        return NULL;
     }
 
-    if (start == 0) {
+    // Find the smallest non empty list that can hold this
+    unsigned int candidates = freeOrders & ~((0x1 << order) - 1);
+    if (candidates == 0) {
         return NULL;
     }
 
-    for (size_t i = 0; i < pages; i++) {
-        setPage(start + i);
+    size_t found = __builtin_ctz(candidates);
+    size_t index = indexOf(freeLists[found]);
+    removeBlock(index, found);
+    freePageCount -= 1 << found;
+
+    // Split off the upper halves we don't need
+    while (found > order) {
+        found--;
+        pushBlock(index + (0x1 << found), found);
+        freePageCount += 1 << found;
     }
 
-    return (void*)(start * PAGE_SIZE);
+    // And give back whatever is left over from rounding up to a power of two
+    if (pages < (0x1u << order)) {
+        freeRange(index + pages, (0x1 << order) - pages);
+    }
+
+    return blockAt(index);
 }
 
 void freePages(void* page, size_t pages) {
 
-    size_t start = ((unsigned int) page) / PAGE_SIZE;
-    for (size_t i = 0; i < pages; i++) {
-        unsetPage(start + i);
+    if (page == NULL || pages == 0) {
+        return;
     }
+
+    freeRange(indexOf(page), pages);
 }
 
+size_t getFreePages(void) {
+    return freePageCount;
+}
+
+size_t getMemoryEnd(void) {
+    return (UNUSABLE_PAGES + mappedPages) * PAGE_SIZE;
+}
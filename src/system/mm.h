@@ -16,8 +16,24 @@ void* allocPage(void);
  */
 void* kalloc(size_t size);
 
+/**
+ * Allocate physically contiguous pages.
+ *
+ * Backed by a buddy allocator, so the returned block is aligned to the
+ * power of two pages is rounded up to. At most 4 MiB can be asked for at once.
+ */
 void* allocPages(size_t pages);
 
+/**
+ * Give back pages starting at page, they don't need to match a single allocation.
+ */
 void freePages(void* page, size_t pages);
 
+size_t getFreePages(void);
+
+/**
+ * The address right after the last page managed by the allocator.
+ */
+size_t getMemoryEnd(void);
+
 #endif
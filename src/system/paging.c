@@ -0,0 +1,459 @@
+#include "system/paging.h"
+#include "system/mm.h"
+#include "system/gdt.h"
+#include "system/panic.h"
+#include "system/cpu.h"
+#include "system/smp.h"
+#include "system/process/stack.h"
+#include "system/interrupt/handler.h"
+
+#define ENTRIES_PER_TABLE 1024
+
+#define DIRECTORY_INDEX(addr) (((size_t) (addr)) >> 22)
+#define TABLE_INDEX(addr) ((((size_t) (addr)) >> 12) & (ENTRIES_PER_TABLE - 1))
+
+#define ENTRY_ADDRESS(entry) ((unsigned int*) ((entry) & ~(PAGE_SIZE - 1)))
+
+#define PRIVATE_FIRST_ENTRY DIRECTORY_INDEX(PRIVATE_AREA_START)
+#define PRIVATE_LAST_ENTRY (DIRECTORY_INDEX(PRIVATE_AREA_END) - 1)
+
+#define IS_PRIVATE(index) ((index) >= PRIVATE_FIRST_ENTRY && (index) <= PRIVATE_LAST_ENTRY)
+
+#define LARGE_PAGE_SIZE (ENTRIES_PER_TABLE * PAGE_SIZE)
+
+#define PAGE_LARGE 0x80
+#define PAGE_GLOBAL 0x100
+
+#define CR0_PAGING (0x1u << 31)
+#define CR4_PSE (0x1u << 4)
+#define CR4_PGE (0x1u << 7)
+
+#define PAGE_FAULT 0x0E
+
+static struct AddressSpace kernelSpace;
+
+// Each CPU keeps the space it's using in its struct Cpu
+#define currentSpace (smp_cpu()->space)
+
+// Bumped whenever a mapping goes away, CPUs that are behind flush their TLB
+static volatile unsigned int tlbGeneration = 0;
+
+static struct PagingStats stats = {0, 0};
+
+// Set on shared mappings, so they're kept in the TLB across CR3 reloads
+static unsigned int globalFlag = 0;
+
+// The boot CPU's, the others allocate theirs
+static char faultStack[PAGE_SIZE] __attribute__((aligned(16)));
+
+static unsigned int* new_table(void);
+
+static unsigned int* table_for(struct AddressSpace* space, void* virt, int create);
+
+static int sync_directory(void* address);
+
+static void map_identity(size_t end);
+
+static void flush_all(void);
+
+void pageFault(unsigned int errCode);
+
+extern void _pageFaultTask(void);
+
+inline static void invalidate(void* virt) {
+    __asm__ __volatile__ ("invlpg (%0)"::"r"(virt):"memory");
+}
+
+inline static void load_directory(unsigned int* directory) {
+    __asm__ __volatile__ ("mov %0, %%cr3"::"r"(directory):"memory");
+}
+
+/**
+ * Build the kernel page directory and turn on paging.
+ *
+ * Every page the allocator manages, and everything below it, is identity
+ * mapped so the kernel keeps working with physical addresses.
+ * Uses 4 MiB pages for it when the CPU supports PSE.
+ */
+void paging_init(void) {
+
+    kernelSpace.directory = new_table();
+    kernelSpace.pages = 0;
+    if (kernelSpace.directory == NULL) {
+        panic();
+    }
+
+    unsigned int cr4;
+    __asm__ __volatile__ ("mov %%cr4, %0":"=r"(cr4));
+
+    if (cpu_has(CPU_PGE)) {
+        globalFlag = PAGE_GLOBAL;
+    }
+
+    if (cpu_has(CPU_PSE)) {
+        cr4 |= CR4_PSE;
+        __asm__ __volatile__ ("mov %0, %%cr4"::"r"(cr4));
+    }
+
+    map_identity(getMemoryEnd());
+
+    currentSpace = &kernelSpace;
+    setupFaultTask(_pageFaultTask, faultStack + sizeof(faultStack), (unsigned int) kernelSpace.directory);
+
+    load_directory(kernelSpace.directory);
+
+    unsigned int cr0;
+    __asm__ __volatile__ ("mov %%cr0, %0":"=r"(cr0));
+    __asm__ __volatile__ ("mov %0, %%cr0"::"r"(cr0 | CR0_PAGING));
+
+    if (globalFlag) {
+        cr4 |= CR4_PGE;
+        __asm__ __volatile__ ("mov %0, %%cr4"::"r"(cr4));
+    }
+}
+
+/**
+ * Set up paging bits that belong to the CPU running this, for the other CPUs.
+ *
+ * The trampoline already turned paging on with the kernel directory.
+ */
+void paging_init_cpu(void) {
+
+    void* stack = allocPage();
+    if (stack == NULL) {
+        panic();
+    }
+
+    currentSpace = &kernelSpace;
+    smp_cpu()->tlbGeneration = tlbGeneration;
+
+    setupFaultTask(_pageFaultTask, (char*) stack + PAGE_SIZE, (unsigned int) kernelSpace.directory);
+}
+
+/**
+ * Drop stale TLB entries, if a mapping went away since this CPU last looked.
+ *
+ * invlpg only reaches the CPU that runs it. Rather than interrupting the
+ * others, they catch up the next time they take the kernel lock, which is
+ * before they can run whatever the page was reused for.
+ */
+void paging_sync(void) {
+
+    struct Cpu* cpu = smp_cpu();
+    if (cpu->tlbGeneration != tlbGeneration) {
+        cpu->tlbGeneration = tlbGeneration;
+        flush_all();
+    }
+}
+
+void flush_all(void) {
+
+    if (globalFlag) {
+        // Global entries survive CR3 reloads, toggling PGE is what drops them
+        unsigned int cr4;
+        __asm__ __volatile__ ("mov %%cr4, %0":"=r"(cr4));
+        __asm__ __volatile__ ("mov %0, %%cr4"::"r"(cr4 & ~CR4_PGE):"memory");
+        __asm__ __volatile__ ("mov %0, %%cr4"::"r"(cr4):"memory");
+    } else {
+        unsigned int cr3;
+        __asm__ __volatile__ ("mov %%cr3, %0":"=r"(cr3));
+        __asm__ __volatile__ ("mov %0, %%cr3"::"r"(cr3):"memory");
+    }
+}
+
+void map_identity(size_t end) {
+
+    size_t addr = 0;
+
+    if (cpu_has(CPU_PSE)) {
+
+        // Round up, there's no harm in mapping past the end of memory
+        for (; addr < end; addr += LARGE_PAGE_SIZE) {
+            kernelSpace.directory[DIRECTORY_INDEX(addr)] = addr | PAGE_LARGE | globalFlag | PAGE_WRITE | PAGE_PRESENT;
+            stats.largePages++;
+        }
+
+        return;
+    }
+
+    for (; addr < end; addr += PAGE_SIZE) {
+        if (paging_map(&kernelSpace, (void*) addr, (void*) addr, PAGE_WRITE) != 0) {
+            panic();
+        }
+    }
+}
+
+struct AddressSpace* paging_kernel_space(void) {
+    return &kernelSpace;
+}
+
+/**
+ * Create an address space sharing every kernel region.
+ *
+ * @return 0 on success, -1 if there's no memory left.
+ */
+int paging_space_create(struct AddressSpace* space) {
+
+    space->directory = new_table();
+    space->pages = 0;
+    if (space->directory == NULL) {
+        return -1;
+    }
+
+    for (size_t i = 0; i < ENTRIES_PER_TABLE; i++) {
+        if (!IS_PRIVATE(i)) {
+            space->directory[i] = kernelSpace.directory[i];
+        }
+    }
+
+    return 0;
+}
+
+/**
+ * Free an address space, along with the private frames it owns.
+ */
+void paging_space_destroy(struct AddressSpace* space) {
+
+    if (space->directory == NULL || space == &kernelSpace) {
+        return;
+    }
+
+    if (space == currentSpace) {
+        paging_switch(&kernelSpace);
+    }
+
+    for (size_t i = PRIVATE_FIRST_ENTRY; i <= PRIVATE_LAST_ENTRY; i++) {
+
+        if (space->directory[i] & PAGE_PRESENT) {
+
+            unsigned int* table = ENTRY_ADDRESS(space->directory[i]);
+            for (size_t j = 0; j < ENTRIES_PER_TABLE; j++) {
+                if ((table[j] & PAGE_PRESENT) && (table[j] & PAGE_OWNED)) {
+                    freePages(ENTRY_ADDRESS(table[j]), 1);
+                }
+            }
+
+            freePages(table, 1);
+        }
+    }
+
+    freePages(space->directory, 1);
+    space->directory = NULL;
+    space->pages = 0;
+}
+
+/**
+ * Make space the active address space.
+ *
+ * Only reloads CR3 when it actually changes, since that flushes the TLB.
+ */
+void paging_switch(struct AddressSpace* space) {
+
+    if (space == currentSpace || space->directory == NULL) {
+        return;
+    }
+
+    currentSpace = space;
+    setTaskDirectory((unsigned int) space->directory);
+    load_directory(space->directory);
+}
+
+unsigned int* new_table(void) {
+
+    unsigned int* table = allocPage();
+    if (table == NULL) {
+        return NULL;
+    }
+
+    for (size_t i = 0; i < ENTRIES_PER_TABLE; i++) {
+        table[i] = 0;
+    }
+
+    return table;
+}
+
+/**
+ * Find the page table for virt.
+ *
+ * Tables for shared regions always live in the kernel directory, other
+ * directories pick them up lazily on their first fault (see sync_directory).
+ */
+unsigned int* table_for(struct AddressSpace* space, void* virt, int create) {
+
+    size_t index = DIRECTORY_INDEX(virt);
+    if (!IS_PRIVATE(index)) {
+        space = &kernelSpace;
+    }
+
+    unsigned int* entry = &space->directory[index];
+
+    if (*entry & PAGE_LARGE) {
+        return NULL;
+    }
+
+    if (!(*entry & PAGE_PRESENT)) {
+
+        if (!create) {
+            return NULL;
+        }
+
+        unsigned int* table = new_table();
+        if (table == NULL) {
+            return NULL;
+        }
+
+        *entry = (unsigned int) table | PAGE_PRESENT | PAGE_WRITE;
+        if (IS_PRIVATE(index)) {
+            *entry |= PAGE_USER;
+        }
+    }
+
+    return ENTRY_ADDRESS(*entry);
+}
+
+/**
+ * Map the page at virt to the frame at phys.
+ *
+ * Mappings in shared regions are seen by every address space, regardless of space.
+ *
+ * @param space The address space to map into.
+ * @param virt A page aligned virtual address.
+ * @param phys A page aligned physical address.
+ * @param flags PAGE_WRITE, PAGE_USER and PAGE_OWNED as needed, the page is always present.
+ *
+ * @return 0 on success, -1 if a page table couldn't be allocated.
+ */
+int paging_map(struct AddressSpace* space, void* virt, void* phys, int flags) {
+
+    unsigned int* table = table_for(space, virt, 1);
+    if (table == NULL) {
+        return -1;
+    }
+
+    unsigned int* entry = &table[TABLE_INDEX(virt)];
+    if (IS_PRIVATE(DIRECTORY_INDEX(virt)) && !(*entry & PAGE_OWNED) && (flags & PAGE_OWNED)) {
+        space->pages++;
+    }
+
+    if (!(*entry & PAGE_PRESENT)) {
+        stats.smallPages++;
+    }
+
+    if (!IS_PRIVATE(DIRECTORY_INDEX(virt))) {
+        flags |= globalFlag;
+    }
+
+    *entry = ((unsigned int) phys & ~(PAGE_SIZE - 1)) | flags | PAGE_PRESENT;
+
+    // Entries of other directories will be dropped from the TLB when CR3 is loaded
+    if (space == currentSpace || !IS_PRIVATE(DIRECTORY_INDEX(virt))) {
+        invalidate(virt);
+    }
+
+    return 0;
+}
+
+/**
+ * Remove the mapping for virt, the frame (even if owned) is left to the caller.
+ */
+void paging_unmap(struct AddressSpace* space, void* virt) {
+
+    unsigned int* table = table_for(space, virt, 0);
+    if (table == NULL) {
+        return;
+    }
+
+    unsigned int* entry = &table[TABLE_INDEX(virt)];
+    if (IS_PRIVATE(DIRECTORY_INDEX(virt)) && (*entry & PAGE_OWNED)) {
+        space->pages--;
+    }
+
+    if (*entry & PAGE_PRESENT) {
+        stats.smallPages--;
+    }
+
+    *entry = 0;
+
+    if (space == currentSpace || !IS_PRIVATE(DIRECTORY_INDEX(virt))) {
+        invalidate(virt);
+    }
+
+    // Shared mappings might be cached on other CPUs, and so might a space that runs there
+    smp_cpu()->tlbGeneration = ++tlbGeneration;
+}
+
+/**
+ * Find the frame virt is mapped to.
+ *
+ * @return The physical address, NULL if it's not mapped.
+ */
+void* paging_lookup(struct AddressSpace* space, void* virt) {
+
+    unsigned int large = kernelSpace.directory[DIRECTORY_INDEX(virt)];
+    if (!IS_PRIVATE(DIRECTORY_INDEX(virt)) && (large & PAGE_LARGE)) {
+        return (char*) (large & ~(LARGE_PAGE_SIZE - 1)) + ((size_t) virt & (LARGE_PAGE_SIZE - 1));
+    }
+
+    unsigned int* table = table_for(space, virt, 0);
+    if (table == NULL || !(table[TABLE_INDEX(virt)] & PAGE_PRESENT)) {
+        return NULL;
+    }
+
+    return (char*) ENTRY_ADDRESS(table[TABLE_INDEX(virt)]) + ((size_t) virt & (PAGE_SIZE - 1));
+}
+
+void paging_get_stats(struct PagingStats* out) {
+    *out = stats;
+}
+
+/**
+ * Copy a shared page table into the current directory, if it's missing there.
+ *
+ * @return 1 if that was the reason for the fault, 0 otherwise.
+ */
+int sync_directory(void* address) {
+
+    size_t index = DIRECTORY_INDEX(address);
+    if (IS_PRIVATE(index) || currentSpace == &kernelSpace) {
+        return 0;
+    }
+
+    unsigned int entry = kernelSpace.directory[index];
+    if (!(entry & PAGE_PRESENT) || currentSpace->directory[index] == entry) {
+        return 0;
+    }
+
+    currentSpace->directory[index] = entry;
+    return 1;
+}
+
+/**
+ * Page fault handler, runs on the fault task.
+ *
+ * @param errCode The error code pushed by the CPU.
+ */
+void pageFault(unsigned int errCode) {
+
+    void* address;
+    __asm__ __volatile__ ("mov %%cr2, %0":"=r"(address));
+
+    if (errCode & PAGE_PRESENT) {
+        showException(PAGE_FAULT);
+    }
+
+    // Faults come from process code too, which doesn't hold the lock
+    smp_lock_kernel();
+
+    if (sync_directory(address)) {
+        smp_unlock_kernel();
+        return;
+    }
+
+    if (stack_grow(address)) {
+        sync_directory(address);
+        smp_unlock_kernel();
+        return;
+    }
+
+    showException(PAGE_FAULT);
+}
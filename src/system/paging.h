@@ -0,0 +1,60 @@
+#ifndef __SYSTEM_PAGING__
+#define __SYSTEM_PAGING__
+
+#include "type.h"
+
+#define PAGE_PRESENT 0x1
+#define PAGE_WRITE 0x2
+#define PAGE_USER 0x4
+#define PAGE_NOCACHE 0x18
+
+// The frame belongs to the mapping, and is freed along with the address space
+#define PAGE_OWNED 0x200
+
+/**
+ * Virtual memory layout:
+ *
+ * 0x00000000 - 0x7FFFFFFF  Physical memory, identity mapped       (shared)
+ * 0x80000000 - 0xBFFFFFFF  Private to each address space
+ * 0xC0000000 - 0xEFFFFFFF  Process stacks                        (shared)
+ * 0xF0000000 - 0xFFFFFFFF  Devices, identity mapped on demand    (shared)
+ *
+ * Shared regions use the same page tables in every address space.
+ */
+#define IDENTITY_MAP_END 0x80000000u
+
+#define PRIVATE_AREA_START 0x80000000u
+#define PRIVATE_AREA_END 0xC0000000u
+
+#define STACK_AREA_START 0xC0000000u
+#define STACK_AREA_END 0xF0000000u
+
+struct AddressSpace {
+    unsigned int* directory;
+    // Frames owned by the private area
+    size_t pages;
+};
+
+void paging_init(void);
+
+void paging_init_cpu(void);
+
+void paging_sync(void);
+
+void paging_get_stats(struct PagingStats* stats);
+
+struct AddressSpace* paging_kernel_space(void);
+
+int paging_space_create(struct AddressSpace* space);
+
+void paging_space_destroy(struct AddressSpace* space);
+
+void paging_switch(struct AddressSpace* space);
+
+int paging_map(struct AddressSpace* space, void* virt, void* phys, int flags);
+
+void paging_unmap(struct AddressSpace* space, void* virt);
+
+void* paging_lookup(struct AddressSpace* space, void* virt);
+
+#endif
@@ -0,0 +1,173 @@
+#include "system/pmu.h"
+#include "system/cpu.h"
+#include "system/call.h"
+#include "system/scheduler.h"
+
+#define CPUID_PMU_LEAF 0xA
+
+#define IA32_PMC0 0xC1
+#define IA32_PERFEVTSEL0 0x186
+#define IA32_PERF_GLOBAL_CTRL 0x38F
+
+// Processes run in ring 0, but count both anyway
+#define EVTSEL_USR (0x1u << 16)
+#define EVTSEL_OS (0x1u << 17)
+#define EVTSEL_EN (0x1u << 22)
+
+#define MAX_COUNTERS 8
+
+// One of the architectural events, as listed in CPUID leaf 0xA
+struct PmuEvent {
+    int event;
+    // Bit in EBX that is set when the event is NOT there
+    unsigned int missingBit;
+    // Event select and unit mask
+    unsigned int select;
+};
+
+static const struct PmuEvent events[] = {
+    { PERF_INSTRUCTIONS, 1, 0xC0 },
+    { PERF_CACHE_MISSES, 4, 0x2E | (0x41 << 8) },
+    { PERF_BRANCH_MISSES, 6, 0xC5 },
+};
+
+#define NUM_EVENTS (sizeof(events) / sizeof(events[0]))
+
+// The event each programmed counter counts
+static int counterEvent[MAX_COUNTERS];
+
+static unsigned int counters = 0;
+
+static unsigned long long counterMask;
+
+// What each CPU's counters read when they were last charged
+static unsigned long long last[SMP_MAX_CPUS][MAX_COUNTERS];
+
+static unsigned int available = 1u << PERF_CYCLES;
+
+/**
+ * Program a general purpose counter for each architectural event the CPU has.
+ *
+ * If there's no architectural PMU, or fewer counters than events, the
+ * rest just aren't counted. Every CPU calls it for its own counters, and
+ * they all come out the same.
+ */
+void pmu_init(void) {
+
+    unsigned int eax, ebx, ecx, edx;
+
+    if (!cpu_has(CPU_MSR) || cpu_info()->maxLeaf < CPUID_PMU_LEAF) {
+        return;
+    }
+
+    cpuid(CPUID_PMU_LEAF, &eax, &ebx, &ecx, &edx);
+
+    unsigned int version = eax & 0xFF;
+    unsigned int generalCounters = (eax >> 8) & 0xFF;
+    unsigned int width = (eax >> 16) & 0xFF;
+    unsigned int knownEvents = (eax >> 24) & 0xFF;
+
+    if (version == 0 || generalCounters == 0 || width == 0) {
+        return;
+    }
+
+    if (generalCounters > MAX_COUNTERS) {
+        generalCounters = MAX_COUNTERS;
+    }
+
+    counterMask = width >= 64 ? ~0ull : (1ull << width) - 1;
+
+    unsigned int cpu = smp_cpu()->index;
+    unsigned int n = 0;
+
+    for (size_t i = 0; i < NUM_EVENTS && n < generalCounters; i++) {
+
+        if (events[i].missingBit >= knownEvents || (ebx & (0x1u << events[i].missingBit))) {
+            continue;
+        }
+
+        wrmsr(IA32_PERFEVTSEL0 + n, 0);
+        wrmsr(IA32_PMC0 + n, 0);
+        wrmsr(IA32_PERFEVTSEL0 + n, events[i].select | EVTSEL_USR | EVTSEL_OS | EVTSEL_EN);
+
+        counterEvent[n] = events[i].event;
+        last[cpu][n] = 0;
+        available |= 1u << events[i].event;
+        n++;
+    }
+
+    counters = n;
+
+    // From version 2 on, counters also need to be enabled globally
+    if (version >= 2 && counters) {
+        wrmsr(IA32_PERF_GLOBAL_CTRL, (1ull << counters) - 1);
+    }
+}
+
+/**
+ * Charge the events counted since the last call to process.
+ *
+ * Called when process is switched out, so every event lands on whoever
+ * was running when it happened.
+ *
+ * @param process The process that has been running.
+ */
+void pmu_account(struct Process* process) {
+
+    unsigned long long* previous = last[smp_cpu()->index];
+
+    for (unsigned int i = 0; i < counters; i++) {
+        unsigned long long value = rdmsr(IA32_PMC0 + i);
+        process->perf[counterEvent[i]] += (value - previous[i]) & counterMask;
+        previous[i] = value;
+    }
+}
+
+/**
+ * Add what a child and its own children counted to its parent.
+ *
+ * @param parent The process that waited for child.
+ * @param child The child that's about to go away.
+ */
+void pmu_reap(struct Process* parent, struct Process* child) {
+
+    parent->childPerf[PERF_CYCLES] += child->cycles + child->childPerf[PERF_CYCLES];
+    for (int i = PERF_CYCLES + 1; i < PERF_EVENTS; i++) {
+        parent->childPerf[i] += child->perf[i] + child->childPerf[i];
+    }
+}
+
+/**
+ * System call that reads the calling process' counters.
+ *
+ * @param who PERF_SELF for its own, PERF_CHILDREN for those of the
+ *            children it already waited for.
+ * @param data Where to store them.
+ *
+ * @return 0 on success, -1 if who is not known.
+ */
+int _perfstat(int who, struct PerfCounters* data) {
+
+    struct Process* process = scheduler_current();
+    const unsigned long long* counts;
+
+    if (who == PERF_SELF) {
+        pmu_account(process);
+        counts = process->perf;
+    } else if (who == PERF_CHILDREN) {
+        counts = process->childPerf;
+    } else {
+        return -1;
+    }
+
+    data->available = available;
+    for (int i = 0; i < PERF_EVENTS; i++) {
+        data->counts[i] = counts[i];
+    }
+
+    if (who == PERF_SELF) {
+        data->counts[PERF_CYCLES] = process->cycles + rdtsc() - scheduler_get_cycles();
+    }
+
+    return 0;
+}
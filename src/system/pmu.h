@@ -0,0 +1,12 @@
+#ifndef __SYSTEM_PMU__
+#define __SYSTEM_PMU__
+
+#include "system/process/process.h"
+
+void pmu_init(void);
+
+void pmu_account(struct Process* process);
+
+void pmu_reap(struct Process* parent, struct Process* child);
+
+#endif
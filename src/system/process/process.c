@@ -1,25 +1,39 @@
 #include "system/process/process.h"
+#include "system/process/stack.h"
+#include "system/fpu.h"
+#include "system/cpu.h"
 #include "system/mm.h"
-#include "system/panic.h"
 #include "system/common.h"
 #include "system/scheduler.h"
 #include "system/call.h"
+#include "system/smp.h"
 #include "library/sys.h"
 
-static int pid = 0;
-
 extern void _interruptEnd(void);
 
-extern void signalPIC(void);
+static int init(struct Process* process, pid_t pid, struct Process* parent, int terminal);
+
+static void push_frame(struct Process* process, int eip, int ret);
 
 inline static void push(int** esp, int val) {
     *esp -= 1;
     **esp = val;
 }
 
-void createProcess(struct Process* process, EntryPoint entryPoint, struct Process* parent, char* args, int terminal) {
+/**
+ * Set up what processes and threads have in common.
+ *
+ * The stack comes first, so a failure leaves nothing behind, the parent included.
+ *
+ * @return 0 on success, -1 if there's no stack slot or memory left.
+ */
+int init(struct Process* process, pid_t pid, struct Process* parent, int terminal) {
+
+    if (stack_create(&process->mm) != 0) {
+        return -1;
+    }
 
-    process->pid = ++pid;
+    process->pid = pid;
     process->terminal = terminal;
     process->active = 0;
 
@@ -27,9 +41,24 @@ void createProcess(struct Process* process, EntryPoint entryPoint, struct Proces
     process->firstChild = NULL;
 
     process->cycles = 0;
+    process->voluntarySwitches = 0;
+    process->involuntarySwitches = 0;
+    process->readySince = rdtsc();
+    process->waitCycles = 0;
+    for (int i = 0; i < PERF_EVENTS; i++) {
+        process->perf[i] = process->childPerf[i] = 0;
+    }
+    process->fpuState = NULL;
     process->timeStart = _time(NULL);
 
     process->prev = NULL;
+
+    process->queue = NULL;
+    process->queuePrev = process->queueNext = NULL;
+    wait_queue_init(&process->childWait);
+    process->futexKey = NULL;
+    process->owned = NULL;
+    process->waitingOn = NULL;
     if (parent == NULL) {
         process->ppid = 0;
         process->next = NULL;
@@ -44,6 +73,79 @@ void createProcess(struct Process* process, EntryPoint entryPoint, struct Proces
         parent->firstChild = process;
     }
 
+    // Children are as nice as their parent, without what it inherited
+    process->schedule.nice = parent ? parent->schedule.nice : 0;
+    process->schedule.priority = NICE_MAX - process->schedule.nice;
+    process->schedule.status = StatusReady;
+    process->schedule.ioWait = 0;
+    process->schedule.done = 0;
+    process->schedule.timedOut = 0;
+    process->schedule.pinned = 0;
+    process->schedule.killed = 0;
+    process->schedule.queued = 0;
+    process->schedule.switching = 0;
+    // Children are scheduled like their parent
+    process->schedule.policy = parent ? parent->schedule.policy : SCHED_DEFAULT;
+    process->schedule.readyPrev = NULL;
+    process->schedule.readyNext = NULL;
+    process->schedule.vruntime = 0;
+    process->schedule.inTree = 0;
+    process->schedule.counted = 0;
+    process->dl.active = 0;
+    process->dl.runnable = 0;
+    process->dl.queued = 0;
+    process->dl.throttled = 0;
+    process->dl.yielded = 0;
+    process->dl.bandwidth = 0;
+    process->dl.misses = 0;
+    process->dl.overruns = 0;
+    process->cpu = 0;
+
+    process->leader = process;
+    process->threads = process->threadNext = NULL;
+    process->liveThreads = 0;
+    wait_queue_init(&process->threadWait);
+    process->exitStatus = 0;
+
+    return 0;
+}
+
+/**
+ * Build the frame a process starts from, as if it was switched out in an interrupt.
+ *
+ * Its arguments have to be on the stack already.
+ *
+ * @param process The process.
+ * @param eip Where it starts.
+ * @param ret Where it goes when it returns from there.
+ */
+void push_frame(struct Process* process, int eip, int ret) {
+    push((int**) &process->mm.esp, ret);
+    push((int**) &process->mm.esp, 0x200);
+    push((int**) &process->mm.esp, 0x08);
+    push((int**) &process->mm.esp, eip);
+    push((int**) &process->mm.esp, (int) _interruptEnd);
+    // The kernel lock is held across the switch, see smp_lock_kernel
+    push((int**) &process->mm.esp, (int) smp_unlock_kernel);
+    push((int**) &process->mm.esp, 0);
+}
+
+/**
+ * Set up a process, ready to be scheduled.
+ *
+ * @return 0 on success, -1 if there's no stack slot or memory left.
+ */
+int createProcess(struct Process* process, pid_t pid, EntryPoint entryPoint, struct Process* parent, char* args, int terminal) {
+
+    if (paging_space_create(&process->mm.space) != 0) {
+        return -1;
+    }
+
+    if (init(process, pid, parent, terminal) != 0) {
+        paging_space_destroy(&process->mm.space);
+        return -1;
+    }
+
     process->entryPoint = entryPoint;
     if (args == NULL) {
         *process->args = 0;
@@ -55,39 +157,70 @@ void createProcess(struct Process* process, EntryPoint entryPoint, struct Proces
         process->args[i] = 0;
     }
 
-    process->schedule.priority = 0;
-    process->schedule.status = StatusReady;
-    process->schedule.inWait = 0;
-    process->schedule.ioWait = 0;
-    process->schedule.done = 0;
+    push((int**) &process->mm.esp, (int) process->args);
+    push_frame(process, (int) entryPoint, (int) exit);
 
-    process->mm.pagesInStack = 256;
-    process->mm.stackStart = allocPages(process->mm.pagesInStack);
+    return 0;
+}
 
-    if (process->mm.stackStart == NULL) {
-        panic();
+/**
+ * Set up a thread of leader.
+ *
+ * Threads have their own stack and are scheduled on their own, but run in
+ * the address space of their leader. They aren't anyone's children, so
+ * they're waited for with thread_join instead.
+ *
+ * @param thread The thread.
+ * @param tid Its id, taken from the same space as pids.
+ * @param leader The process it belongs to.
+ * @param start Where it starts, it's called with entry and arg, and must not return.
+ * @param entry The first argument to start.
+ * @param arg The second argument to start.
+ *
+ * @return 0 on success, -1 if there's no stack slot or memory left.
+ */
+int createThread(struct Process* thread, pid_t tid, struct Process* leader, ThreadStart start, void* entry, void* arg) {
+
+    // Before it's linked to the leader, so there's nothing to undo
+    if (init(thread, tid, NULL, leader->terminal) != 0) {
+        return -1;
     }
 
-    process->mm.esp = (char*)process->mm.stackStart + PAGE_SIZE * process->mm.pagesInStack;
-    push((int**) &process->mm.esp, (int) process->args);
-    push((int**) &process->mm.esp, (int) exit);
-    push((int**) &process->mm.esp, 0x200);
-    push((int**) &process->mm.esp, 0x08);
-    push((int**) &process->mm.esp, (int) entryPoint);
-    push((int**) &process->mm.esp, (int) _interruptEnd);
-    push((int**) &process->mm.esp, (int) signalPIC);
-    push((int**) &process->mm.esp, 0);
+    thread->ppid = leader->ppid;
+    thread->leader = leader;
+    thread->schedule.policy = leader->schedule.policy;
+    thread->schedule.nice = leader->schedule.nice;
+    thread->schedule.priority = NICE_MAX - thread->schedule.nice;
+    thread->entryPoint = NULL;
+    *thread->args = 0;
+    thread->mm.space.directory = NULL;
+    thread->mm.space.pages = 0;
+
+    thread->threadNext = leader->threads;
+    leader->threads = thread;
+    leader->liveThreads++;
+
+    push((int**) &thread->mm.esp, (int) arg);
+    push((int**) &thread->mm.esp, (int) entry);
+    // start ends with thread_exit, there's nowhere to return to
+    push_frame(thread, (int) start, 0);
+
+    return 0;
 }
 
 void exitProcess(struct Process* process) {
     process->schedule.done = 1;
+    fpu_release(process);
 }
 
 void destroyProcess(struct Process* process) {
     process->pid = 0;
     if (process->mm.stackStart) {
-        freePages(process->mm.stackStart, process->mm.pagesInStack);
-        process->mm.stackStart = NULL;
+        stack_destroy(&process->mm);
+    }
+    // Threads use their leader's
+    if (process->leader == process) {
+        paging_space_destroy(&process->mm.space);
     }
     exitProcess(process);
 }
@@ -2,16 +2,26 @@
 #define __SYSTEM_PROCESS_PROCESS__
 
 #include "system/mm.h"
+#include "system/paging.h"
+#include "system/wheel.h"
+#include "system/processQueue.h"
+#include "system/sync.h"
 #include "type.h"
 
 #define NO_TERMINAL -1
 
 typedef void (*EntryPoint)(char*);
 
+// Threads start here, with what was passed to thread_create
+typedef void (*ThreadStart)(void* entry, void* arg);
+
 struct ProcessMemory {
     void* esp;
+    // The bottom of the stack slot, which is the guard page
     void* stackStart;
+    // Pages backed so far, counting down from the top of the slot
     int pagesInStack;
+    struct AddressSpace space;
 };
 
 enum ProcessStatus {
@@ -22,10 +32,88 @@ enum ProcessStatus {
 
 struct ProcessSchedule {
     enum ProcessStatus status;
-    unsigned int priority:2;
-    unsigned int inWait:1;
+    // Between NICE_MIN and NICE_MAX, see nice
+    int nice;
+    // What it runs at, from 0 to PRIORITY_LEVELS - 1. It's NICE_MAX - nice,
+    // or more while it owns a wait queue with more urgent processes in it.
+    int priority;
     unsigned int ioWait:1;
     unsigned int done:1;
+    unsigned int timedOut:1;
+    // Idle processes stay on their CPU, the rest can be moved to an idle one
+    unsigned int pinned:1;
+    // Killed while running on another CPU, which finishes the job
+    unsigned int killed:1;
+
+    // Moving to another policy, see scheduler_set_default
+    unsigned int switching:1;
+
+    // One of the SCHED_ policies, or SCHED_DEFAULT
+    int policy;
+
+    // Links for the ready lists of the policies that keep them
+    unsigned int queued:1;
+    struct Process* readyPrev;
+    struct Process* readyNext;
+
+    // Used by the multilevel policy
+    unsigned int level:3;
+    size_t enqueued;
+
+    // Used by the priority policy
+    int acumPriority;
+
+    // Used by the fair policy, which keeps ready processes in a red-black tree
+    // ordered by vruntime, the TSC cycles they ran scaled by their weight
+    unsigned long long vruntime;
+    // When vruntime was last brought up to date, and when it was last picked
+    unsigned long long execStart;
+    unsigned long long picked;
+    unsigned long weight;
+    struct Process* rbParent;
+    struct Process* rbLeft;
+    struct Process* rbRight;
+    unsigned int rbRed:1;
+    unsigned int inTree:1;
+    // Its weight is part of its CPU's load
+    unsigned int counted:1;
+};
+
+/**
+ * Reservation of a process in the deadline class, which runs before every policy.
+ *
+ * Times are in TSC cycles. Each period it may run for runtime, and that
+ * should be done within deadline of the period's start.
+ */
+struct ProcessDeadline {
+    unsigned long long runtime;
+    unsigned long long deadline;
+    unsigned long long period;
+    // The share of a CPU it reserved, see DEADLINE_BANDWIDTH_SHIFT
+    unsigned long long bandwidth;
+
+    // When the current job must be done, and how much of its runtime is left
+    unsigned long long absDeadline;
+    long long budget;
+    unsigned long long execStart;
+
+    // Where it is in its CPU's heap, while it's there
+    size_t heapIndex;
+
+    // Jobs that ran past their deadline, and times it ran out of budget
+    size_t misses;
+    size_t overruns;
+
+    // Gives the budget back at the next period, once it ran out
+    struct TimerEvent replenish;
+
+    unsigned int active:1;
+    unsigned int runnable:1;
+    unsigned int queued:1;
+    unsigned int throttled:1;
+    unsigned int yielded:1;
+    // The current job already counted as a miss
+    unsigned int missed:1;
 };
 
 struct Process {
@@ -45,17 +133,77 @@ struct Process {
     struct Process* prev;
     struct Process* next;
 
+    // Used by the process table
+    struct Process* hashNext;
+    struct Process* tablePrev;
+    struct Process* tableNext;
+
+    // Links for the ready queue, or the wait queue it's blocked on
+    struct ProcessQueue* queue;
+    struct Process* queuePrev;
+    struct Process* queueNext;
+
+    // Where it sleeps while waiting for its children
+    struct WaitQueue childWait;
+
+    // The futex it sleeps on, if any
+    void* futexKey;
+
+    // Wait queues it owns, and the one it sleeps on, for priority inheritance
+    struct WaitQueue* owned;
+    struct WaitQueue* waitingOn;
+
+    // The process a thread belongs to, which is the process itself for the main thread.
+    // Only the leader's address space is used.
+    struct Process* leader;
+    // The other threads, linked from the leader
+    struct Process* threads;
+    struct Process* threadNext;
+    // Threads that haven't exited, the process can't be waited for until they have
+    size_t liveThreads;
+    // Where thread_join sleeps
+    struct WaitQueue threadWait;
+    // What a thread passed to thread_exit
+    int exitStatus;
+
     struct ProcessSchedule schedule;
+    struct ProcessDeadline dl;
+    // Index of the CPU whose run queue it belongs to
+    unsigned int cpu;
     struct ProcessMemory mm;
 
+    // Wakes the process up from sleeps and timed waits
+    struct TimerEvent timeout;
+
     unsigned long long cycles; 
+    size_t voluntarySwitches;
+    size_t involuntarySwitches;
+    // When it last became ready, and the total time spent ready but not running
+    unsigned long long readySince;
+    unsigned long long waitCycles;
+
+    // Hardware events counted while it ran, and those of the children it waited for
+    unsigned long long perf[PERF_EVENTS];
+    unsigned long long childPerf[PERF_EVENTS];
+
+    // FPU and SSE registers, allocated on first use
+    void* fpuState;
     time_t timeStart;
 };
 
-void createProcess(struct Process* process, EntryPoint entryPoint, struct Process* parent, char* args, int terminal);
+int createProcess(struct Process* process, pid_t pid, EntryPoint entryPoint, struct Process* parent, char* args, int terminal);
+
+int createThread(struct Process* thread, pid_t tid, struct Process* leader, ThreadStart start, void* entry, void* arg);
 
 void destroyProcess(struct Process* process);
 
 void exitProcess(struct Process* process);
 
+/**
+ * The address space a process or thread runs in.
+ */
+inline static struct AddressSpace* process_space(struct Process* process) {
+    return &process->leader->mm.space;
+}
+
 #endif
@@ -0,0 +1,218 @@
+#include "system/process/stack.h"
+#include "system/paging.h"
+#include "system/mm.h"
+#include "system/panic.h"
+
+#define STACK_SLOT_SIZE (STACK_SLOT_PAGES * PAGE_SIZE)
+#define STACK_SLOTS ((STACK_AREA_END - STACK_AREA_START) / STACK_SLOT_SIZE)
+
+#define MAX_DEFERRED 8
+
+static struct ProcessMemory* slots[STACK_SLOTS];
+
+static size_t nextSlot = 0;
+
+// Stacks destroyed while still in use, they are released once we're off them
+static struct ProcessMemory deferred[MAX_DEFERRED];
+
+static size_t slot_of(void* address);
+
+static char* stack_top(struct ProcessMemory* mm);
+
+static int commit_pages(struct ProcessMemory* mm, char* bottom);
+
+static void release(struct ProcessMemory* mm);
+
+static int in_use(struct ProcessMemory* mm);
+
+static int defer(struct ProcessMemory* mm);
+
+size_t slot_of(void* address) {
+    return ((size_t) address - STACK_AREA_START) / STACK_SLOT_SIZE;
+}
+
+char* stack_top(struct ProcessMemory* mm) {
+    return (char*) mm->stackStart + STACK_SLOT_SIZE;
+}
+
+/**
+ * Back every page from bottom up to the lowest page already mapped.
+ *
+ * The committed part of a stack is always contiguous from the top, which
+ * is what lets pagesInStack describe it on its own.
+ */
+int commit_pages(struct ProcessMemory* mm, char* bottom) {
+
+    char* page = stack_top(mm) - mm->pagesInStack * PAGE_SIZE;
+    while (page > bottom) {
+
+        page -= PAGE_SIZE;
+
+        void* frame = allocPage();
+        if (frame == NULL) {
+            return 0;
+        }
+
+        if (paging_map(paging_kernel_space(), page, frame, PAGE_WRITE) != 0) {
+            freePages(frame, 1);
+            return 0;
+        }
+
+        mm->pagesInStack++;
+    }
+
+    return 1;
+}
+
+/**
+ * Reserve a stack slot and back the top of it.
+ *
+ * @return 0 on success, -1 if there are no slots or memory left.
+ */
+int stack_create(struct ProcessMemory* mm) {
+
+    stack_reap();
+
+    size_t slot = 0;
+    for (size_t i = 0; i < STACK_SLOTS; i++) {
+
+        slot = (nextSlot + i) % STACK_SLOTS;
+        if (slots[slot] == NULL) {
+            break;
+        }
+    }
+
+    if (slots[slot] != NULL) {
+        return -1;
+    }
+
+    nextSlot = (slot + 1) % STACK_SLOTS;
+    slots[slot] = mm;
+
+    mm->stackStart = (void*) (STACK_AREA_START + slot * STACK_SLOT_SIZE);
+    mm->pagesInStack = 0;
+
+    if (!commit_pages(mm, stack_top(mm) - STACK_INITIAL_PAGES * PAGE_SIZE)) {
+        release(mm);
+        return -1;
+    }
+
+    mm->esp = stack_top(mm);
+
+    return 0;
+}
+
+void release(struct ProcessMemory* mm) {
+
+    char* page = stack_top(mm);
+    for (int i = 0; i < mm->pagesInStack; i++) {
+
+        page -= PAGE_SIZE;
+
+        void* frame = paging_lookup(paging_kernel_space(), page);
+        paging_unmap(paging_kernel_space(), page);
+        freePages(frame, 1);
+    }
+
+    slots[slot_of(mm->stackStart)] = NULL;
+    mm->stackStart = NULL;
+    mm->pagesInStack = 0;
+}
+
+int in_use(struct ProcessMemory* mm) {
+
+    char* esp;
+    __asm__ __volatile__ ("mov %%esp, %0":"=r"(esp));
+
+    return esp >= (char*) mm->stackStart && esp < stack_top(mm);
+}
+
+/**
+ * Keep a stack in the deferred list, so it outlives the process it belonged to.
+ *
+ * @return 1 if there was room for it, 0 otherwise.
+ */
+int defer(struct ProcessMemory* mm) {
+
+    for (size_t i = 0; i < MAX_DEFERRED; i++) {
+        if (deferred[i].stackStart == NULL) {
+            deferred[i] = *mm;
+            slots[slot_of(mm->stackStart)] = &deferred[i];
+            return 1;
+        }
+    }
+
+    return 0;
+}
+
+/**
+ * Unmap a stack and give back its pages and slot.
+ *
+ * If we're running on it (a process killing itself), the stack is kept
+ * around until the next time stack_reap finds us elsewhere.
+ */
+void stack_destroy(struct ProcessMemory* mm) {
+
+    if (in_use(mm)) {
+
+        // Only the stack we're on can be in use, so reaping always makes room
+        if (!defer(mm)) {
+            stack_reap();
+            if (!defer(mm)) {
+                panic();
+            }
+        }
+
+        mm->stackStart = NULL;
+        mm->pagesInStack = 0;
+        return;
+    }
+
+    release(mm);
+}
+
+/**
+ * Release the stacks whose destruction was deferred and aren't in use anymore.
+ */
+void stack_reap(void) {
+
+    for (size_t i = 0; i < MAX_DEFERRED; i++) {
+        if (deferred[i].stackStart != NULL && !in_use(&deferred[i])) {
+            release(&deferred[i]);
+        }
+    }
+}
+
+/**
+ * Grow the stack holding address, if address is inside one.
+ *
+ * Called from the page fault handler. Everything between the fault and
+ * what's already mapped gets backed, plus one more page of headroom.
+ *
+ * @return 1 if the fault was handled, 0 otherwise.
+ */
+int stack_grow(void* address) {
+
+    if ((size_t) address < STACK_AREA_START || (size_t) address >= STACK_AREA_END) {
+        return 0;
+    }
+
+    struct ProcessMemory* mm = slots[slot_of(address)];
+    if (mm == NULL) {
+        return 0;
+    }
+
+    char* page = (char*) ((size_t) address & ~(PAGE_SIZE - 1));
+    char* guard = (char*) mm->stackStart;
+
+    if (page <= guard) {
+        // Stack overflow
+        return 0;
+    }
+
+    if (page - PAGE_SIZE > guard) {
+        page -= PAGE_SIZE;
+    }
+
+    return commit_pages(mm, page);
+}
@@ -0,0 +1,21 @@
+#ifndef __SYSTEM_PROCESS_STACK__
+#define __SYSTEM_PROCESS_STACK__
+
+#include "system/process/process.h"
+
+/**
+ * Every stack gets a fixed slot of virtual memory, with a guard page at the bottom.
+ * Only STACK_INITIAL_PAGES are backed at first, the rest are mapped on page faults.
+ */
+#define STACK_SLOT_PAGES 256
+#define STACK_INITIAL_PAGES 2
+
+int stack_create(struct ProcessMemory* mm);
+
+void stack_destroy(struct ProcessMemory* mm);
+
+int stack_grow(void* address);
+
+void stack_reap(void);
+
+#endif
@@ -1,40 +1,236 @@
 #include "system/process/table.h"
 #include "system/scheduler.h"
-#include "drivers/tty/tty.h"
+#include "system/slab.h"
+#include "system/pmu.h"
+#include "system/smp.h"
+#include "system/sync.h"
 
-#define PTABLE_SIZE 64
+// Both grow by doubling, so there's no limit but memory
+#define INITIAL_BUCKETS 16
+#define INITIAL_PIDS 64
 
-static struct Process *processTable[PTABLE_SIZE] = {0};
+#define BITS_PER_WORD 32
 
-static struct Process* freeStructures = NULL;
+// Pid to process, chained through hashNext. Pids are small and dense, so
+// the low bits are a good enough hash.
+static struct Process** buckets = NULL;
 
-static void process_table_remove(struct Process* process);
+static size_t bucketCount = 0;
+
+static size_t processCount = 0;
+
+// Every process, in creation order, so they can be listed
+static struct Process* first = NULL;
+
+static struct Process* last = NULL;
+
+// Bit n is set while pid n is in use
+static unsigned int* pidMap = NULL;
+
+static size_t pidCount = 0;
+
+static pid_t lastPid = 0;
+
+// Orphans are handed to it
+static struct Process* idle = NULL;
+
+static int process_table_remove(struct Process* process);
+
+static void unlink_child(struct Process* parent, struct Process* child);
+
+static void kill_threads(struct Process* leader);
+
+static void thread_done(struct Process* thread);
 
 static struct Process* waitable_child(struct Process* process);
 
-struct Process* process_table_new(EntryPoint entryPoint, char* args, struct Process* parent, int kernel, int terminal, int active) {
+static void timeout_expired(void* data);
+
+static int grow_buckets(void);
+
+static int grow_pids(void);
+
+static pid_t alloc_pid(void);
+
+static void free_pid(pid_t pid);
+
+static void hash_insert(struct Process* process);
+
+static void hash_remove(struct Process* process);
+
+int grow_buckets(void) {
+
+    size_t count = bucketCount ? bucketCount * 2 : INITIAL_BUCKETS;
+    struct Process** table = kmalloc(count * sizeof(struct Process*));
+    if (table == NULL) {
+        return -1;
+    }
+
+    for (size_t i = 0; i < count; i++) {
+        table[i] = NULL;
+    }
+
+    for (struct Process* p = first; p != NULL; p = p->tableNext) {
+        size_t bucket = p->pid & (count - 1);
+        p->hashNext = table[bucket];
+        table[bucket] = p;
+    }
+
+    kfree(buckets);
+    buckets = table;
+    bucketCount = count;
+
+    return 0;
+}
+
+int grow_pids(void) {
+
+    size_t count = pidCount ? pidCount * 2 : INITIAL_PIDS;
+    unsigned int* map = kmalloc(count / 8);
+    if (map == NULL) {
+        return -1;
+    }
 
     size_t i;
-    for (i = 0; i < PTABLE_SIZE; i++) {
-        if (processTable[i] == NULL) {
-            break;
+    for (i = 0; i < pidCount / BITS_PER_WORD; i++) {
+        map[i] = pidMap[i];
+    }
+    for (; i < count / BITS_PER_WORD; i++) {
+        map[i] = 0;
+    }
+
+    // Pid 0 means no process
+    map[0] |= 1;
+
+    kfree(pidMap);
+    pidMap = map;
+    pidCount = count;
+
+    return 0;
+}
+
+/**
+ * Get a free pid.
+ *
+ * Pids are handed out going up from the last one, so a pid that was just
+ * freed isn't reused right away.
+ *
+ * @return The pid, or 0 if we ran out of memory.
+ */
+pid_t alloc_pid(void) {
+
+    if (pidCount == 0 && grow_pids() != 0) {
+        return 0;
+    }
+
+    size_t words = pidCount / BITS_PER_WORD;
+    size_t start = (lastPid + 1) % pidCount;
+    size_t index = start / BITS_PER_WORD;
+
+    // Ignore the bits before start in its word, they're checked on the way around
+    unsigned int free = ~pidMap[index] & (~0u << (start % BITS_PER_WORD));
+
+    for (size_t i = 0; i <= words; i++) {
+
+        if (free) {
+            pid_t pid = index * BITS_PER_WORD + __builtin_ctz(free);
+            pidMap[pid / BITS_PER_WORD] |= 1u << (pid % BITS_PER_WORD);
+            lastPid = pid;
+            return pid;
         }
+
+        index = (index + 1) % words;
+        free = ~pidMap[index];
     }
 
-    if (i == PTABLE_SIZE) {
-        return NULL;
+    // Everything is taken, so the first new pid is free
+    pid_t pid = pidCount;
+    if (grow_pids() != 0) {
+        return 0;
     }
 
-    struct Process* p;
-    if (freeStructures == NULL) {
-        p = kalloc(sizeof(struct Process));
+    pidMap[pid / BITS_PER_WORD] |= 1u << (pid % BITS_PER_WORD);
+    lastPid = pid;
+    return pid;
+}
+
+void free_pid(pid_t pid) {
+    pidMap[pid / BITS_PER_WORD] &= ~(1u << (pid % BITS_PER_WORD));
+}
+
+void hash_insert(struct Process* process) {
+
+    size_t bucket = process->pid & (bucketCount - 1);
+    process->hashNext = buckets[bucket];
+    buckets[bucket] = process;
+
+    process->tablePrev = last;
+    process->tableNext = NULL;
+    if (last) {
+        last->tableNext = process;
     } else {
-        p = freeStructures;
-        freeStructures = p->next;
+        first = process;
+    }
+    last = process;
+
+    processCount++;
+}
+
+void hash_remove(struct Process* process) {
+
+    struct Process** link = &buckets[process->pid & (bucketCount - 1)];
+    while (*link != NULL && *link != process) {
+        link = &(*link)->hashNext;
     }
 
-    processTable[i] = p;
-    createProcess(p, entryPoint, parent, args, terminal);
+    if (*link != NULL) {
+        *link = process->hashNext;
+    }
+
+    if (process->tablePrev) {
+        process->tablePrev->tableNext = process->tableNext;
+    } else {
+        first = process->tableNext;
+    }
+
+    if (process->tableNext) {
+        process->tableNext->tablePrev = process->tablePrev;
+    } else {
+        last = process->tablePrev;
+    }
+
+    processCount--;
+}
+
+struct Process* process_table_new(EntryPoint entryPoint, char* args, struct Process* parent, int kernel, int terminal, int active) {
+
+    if (processCount >= bucketCount && grow_buckets() != 0) {
+        return NULL;
+    }
+
+    struct Process* p = kmalloc(sizeof(struct Process));
+    if (p == NULL) {
+        return NULL;
+    }
+
+    pid_t pid = alloc_pid();
+    if (pid == 0) {
+        kfree(p);
+        return NULL;
+    }
+
+    if (createProcess(p, pid, entryPoint, parent, args, terminal) != 0) {
+        free_pid(pid);
+        kfree(p);
+        return NULL;
+    }
+
+    wheel_event_init(&p->timeout, timeout_expired, p);
+    hash_insert(p);
+
+    if (idle == NULL) {
+        idle = p;
+    }
 
     p->active = active;
     if (parent && active) {
@@ -46,26 +242,86 @@ struct Process* process_table_new(EntryPoint entryPoint, char* args, struct Proc
     return p;
 }
 
-void process_table_remove(struct Process* process) {
+/**
+ * Add a thread to a process.
+ *
+ * @param leader The process.
+ * @param start Where the thread starts, see createThread.
+ * @param entry The first argument to start.
+ * @param arg The second argument to start.
+ *
+ * @return The thread, or NULL if we ran out of memory or stack slots.
+ */
+struct Process* process_table_new_thread(struct Process* leader, ThreadStart start, void* entry, void* arg) {
+
+    if (processCount >= bucketCount && grow_buckets() != 0) {
+        return NULL;
+    }
 
-    for (size_t i = 0; i < PTABLE_SIZE; i++) {
-        if (processTable[i] == process) {
-            processTable[i] = NULL;
-            break;
-        }
+    struct Process* t = kmalloc(sizeof(struct Process));
+    if (t == NULL) {
+        return NULL;
     }
 
+    pid_t tid = alloc_pid();
+    if (tid == 0) {
+        kfree(t);
+        return NULL;
+    }
+
+    if (createThread(t, tid, leader, start, entry, arg) != 0) {
+        free_pid(tid);
+        kfree(t);
+        return NULL;
+    }
+
+    wheel_event_init(&t->timeout, timeout_expired, t);
+    hash_insert(t);
+
+    scheduler_add(t);
+
+    return t;
+}
+
+/**
+ * Free a process, along with the threads nobody joined.
+ *
+ * Nothing that may still run is freed: not a process with live threads,
+ * which might be running on other CPUs, nor a thread that isn't done.
+ *
+ * @param process The process or thread.
+ *
+ * @return 1 if it was freed, 0 if it was refused.
+ */
+int process_table_remove(struct Process* process) {
+
+    if (process->leader == process ? process->liveThreads > 0 : !process->schedule.done) {
+        return 0;
+    }
+
+    // Threads nobody joined go along with the process
+    while (process->threads != NULL) {
+        struct Process* t = process->threads;
+        process->threads = t->threadNext;
+        process_table_remove(t);
+    }
+
+    hash_remove(process);
+    free_pid(process->pid);
+
     destroyProcess(process);
-    process->next = freeStructures;
-    freeStructures = process;
+    kfree(process);
+
+    return 1;
 }
 
 void process_table_exit(struct Process* process) {
 
+    wheel_cancel(&process->timeout);
+
     if (process->firstChild) {
 
         struct Process* c = process->firstChild;
-        struct Process* idle = processTable[0];
 
         do {
             // We asign it to the idle process
@@ -74,15 +330,42 @@ void process_table_exit(struct Process* process) {
         } while (c->next && (c = c->next));
 
         c->next = idle->firstChild;
-        idle->firstChild->prev = c;
+        if (idle->firstChild) {
+            idle->firstChild->prev = c;
+        }
 
         idle->firstChild = process->firstChild;
     }
 
+    if (process->leader == process) {
+        kill_threads(process);
+    }
+
+    // If it was blocked, it's also leaving whatever it was waiting on
+    if (process->queue != NULL) {
+        process_queue_remove(process->queue, process);
+    }
+
+    // And whoever owns that doesn't inherit its priority anymore
+    struct WaitQueue* waitingOn = process->waitingOn;
+    process->waitingOn = NULL;
+    if (waitingOn != NULL && waitingOn->owner != NULL) {
+        wait_queue_update_priority(waitingOn->owner);
+    }
+
+    // Nobody's left to hurry on behalf of the queues it owned, and a mutex
+    // it held is free now, so whoever waits on them has to look again
+    while (process->owned != NULL) {
+        struct WaitQueue* queue = process->owned;
+        wait_queue_set_owner(queue, NULL);
+        wait_queue_wake_all(queue);
+    }
+
     scheduler_remove(process);
-    tty_detach_process(process);
 
-    if (process->parent) {
+    if (process->leader != process) {
+        thread_done(process);
+    } else if (process->parent) {
 
         if (process->active) {
             process->parent->active = 1;
@@ -92,37 +375,95 @@ void process_table_exit(struct Process* process) {
         }
 
         exitProcess(process);
+        wait_queue_wake_all(&process->parent->childWait);
 
-        if (process->parent->schedule.inWait) {
-            process_table_unblock(process->parent);
+    } else {
+        process_table_remove(process);
+    }
+}
+
+/**
+ * Kill every thread of a process that's exiting.
+ *
+ * Those running on other CPUs are only marked, and the process stays
+ * around until they're gone, since they still run in its address space.
+ */
+void kill_threads(struct Process* leader) {
+
+    for (struct Process* t = leader->threads; t != NULL; t = t->threadNext) {
+        if (!t->schedule.done) {
+            process_table_kill(t);
         }
+    }
+}
+
+/**
+ * Leave an exited thread for thread_join, and tell whoever waits for it.
+ */
+void thread_done(struct Process* thread) {
 
+    struct Process* leader = thread->leader;
+
+    exitProcess(thread);
+    leader->liveThreads--;
+    wait_queue_wake_all(&leader->threadWait);
+
+    if (!leader->schedule.done || leader->liveThreads > 0) {
+        return;
+    }
+
+    if (leader->parent == NULL || leader->parent == idle) {
+        // Nobody will wait for it, so its last thread frees it
+        if (leader->parent) {
+            unlink_child(leader->parent, leader);
+        }
+        process_table_remove(leader);
     } else {
-        process_table_remove(process);
+        // The process might have been waiting for its last thread to be waited for
+        wait_queue_wake_all(&leader->parent->childWait);
+    }
+}
+
+/**
+ * Free a thread that has exited.
+ *
+ * @param thread The thread, which must be done.
+ */
+void process_table_reap_thread(struct Process* thread) {
+
+    struct Process** link = &thread->leader->threads;
+    while (*link != thread) {
+        link = &(*link)->threadNext;
     }
+    *link = thread->threadNext;
+
+    process_table_remove(thread);
 }
 
-pid_t process_table_wait(struct Process* process) {
+pid_t process_table_wait(struct Process* process, size_t timeout) {
 
     if (process->firstChild != NULL) {
 
         struct Process* c;
+        process_table_timeout(process, timeout);
+
         while ((c = waitable_child(process)) == NULL) {
 
-            process->schedule.inWait = 1;
-            process_table_block(process);
+            if (process->schedule.timedOut) {
+                return 0;
+            }
 
-            scheduler_do();
+            wait_queue_sleep(&process->childWait);
         }
 
-        process->schedule.inWait = 0;
-        if (c->prev == NULL) {
-            process->firstChild = c->next;
-        } else {
-            c->prev->next = c->next;
-        }
+        process_table_timeout(process, 0);
+        unlink_child(process, c);
 
         pid_t pid = c->pid;
+        pmu_reap(process, c);
+        for (struct Process* t = c->threads; t != NULL; t = t->threadNext) {
+            pmu_reap(process, t);
+        }
         process_table_remove(c);
 
         return pid;
@@ -131,12 +472,25 @@ pid_t process_table_wait(struct Process* process) {
     return -1;
 }
 
+void unlink_child(struct Process* parent, struct Process* child) {
+
+    if (child->prev == NULL) {
+        parent->firstChild = child->next;
+    } else {
+        child->prev->next = child->next;
+    }
+
+    if (child->next) {
+        child->next->prev = child->prev;
+    }
+}
+
 struct Process* waitable_child(struct Process* process) {
 
     struct Process* c = process->firstChild;
     while (c != NULL) {
 
-        if (c->schedule.done) {
+        if (c->schedule.done && c->liveThreads == 0) {
             return c;
         }
 
@@ -148,19 +502,48 @@ struct Process* waitable_child(struct Process* process) {
 
 struct Process* process_table_get(pid_t pid) {
 
-    struct Process* c;
-    for (size_t i = 0; i < PTABLE_SIZE; i++) {
+    if (bucketCount == 0) {
+        return NULL;
+    }
 
-        c = processTable[i];
-        if (c != NULL && c->pid == pid) {
-            return c;
-        }
+    struct Process* p = buckets[pid & (bucketCount - 1)];
+    while (p != NULL && p->pid != pid) {
+        p = p->hashNext;
     }
 
-    return NULL;
+    return p;
 }
 
-void process_table_kill(struct Process* process) {
+/**
+ * The oldest process in the table, to walk all of them with process_table_next.
+ */
+struct Process* process_table_first(void) {
+    return first;
+}
+
+struct Process* process_table_next(struct Process* process) {
+    return process->tableNext;
+}
+
+/**
+ * Kill a process, and all of its children.
+ *
+ * A process running on another CPU can't be torn down from under it, so
+ * it's only marked, and that CPU kills it on its way out of the kernel.
+ * A child left like that is handed to the idle process along with the rest.
+ *
+ * @param process The process.
+ *
+ * @return 1 if it's gone, 0 if it was left to its CPU.
+ */
+int process_table_kill(struct Process* process) {
+
+    struct Cpu* cpu = &smp_cpus[process->cpu];
+    if (process == cpu->curr && cpu != smp_cpu()) {
+        process->schedule.killed = 1;
+        smp_kick(cpu);
+        return 0;
+    }
 
     struct Process* c = process->firstChild;
     struct Process* next;
@@ -168,13 +551,18 @@ void process_table_kill(struct Process* process) {
 
         next = c->next;
 
-        process_table_kill(c);
-        process_table_remove(c);
+        // One with threads left on other CPUs goes to the idle process
+        // along with the rest, and its last thread frees it
+        if (process_table_kill(c) && c->liveThreads == 0) {
+            unlink_child(process, c);
+            process_table_remove(c);
+        }
 
         c = next;
     }
 
     process_table_exit(process);
+    return 1;
 }
 
 void process_table_block(struct Process* process) {
@@ -183,7 +571,91 @@ void process_table_block(struct Process* process) {
 }
 
 void process_table_unblock(struct Process* process) {
+
+    if (process->schedule.status != StatusBlocked) {
+        return;
+    }
+
+    // Blocked processes are either in a wait queue, or in none at all
+    if (process->queue != NULL) {
+        process_queue_remove(process->queue, process);
+    }
+
     process->schedule.status = StatusReady;
     scheduler_unblock(process);
 }
 
+/**
+ * Block a process on a wait queue.
+ *
+ * As with process_table_block, the caller has to call the scheduler after this.
+ *
+ * @param process The process to block.
+ * @param queue The wait queue of whatever it's waiting for.
+ */
+void process_table_wait_on(struct Process* process, struct ProcessQueue* queue) {
+    process_table_block(process);
+    process_queue_push(queue, process);
+}
+
+/**
+ * Unblock every process in a wait queue.
+ *
+ * @param queue The wait queue.
+ */
+void process_table_wake(struct ProcessQueue* queue) {
+
+    struct Process* process;
+    while ((process = queue->first) != NULL) {
+        process_table_unblock(process);
+    }
+}
+
+
+/**
+ * Arm the process' timeout, or disarm it if ticks is 0.
+ *
+ * When it expires, schedule.timedOut is set and the process is woken up
+ * from whatever it was blocked on.
+ *
+ * @param process The process.
+ * @param ticks Ticks until it expires.
+ */
+void process_table_timeout(struct Process* process, size_t ticks) {
+
+    process->schedule.timedOut = 0;
+    if (ticks) {
+        wheel_add(&process->timeout, ticks);
+    } else {
+        wheel_cancel(&process->timeout);
+    }
+}
+
+/**
+ * Block the process for a number of ticks.
+ *
+ * @param process The process, which must be the current one.
+ * @param ticks How long to sleep.
+ */
+void process_table_sleep(struct Process* process, size_t ticks) {
+
+    if (ticks == 0) {
+        return;
+    }
+
+    process_table_timeout(process, ticks);
+
+    while (!process->schedule.timedOut) {
+        process_table_block(process);
+        scheduler_do();
+    }
+}
+
+void timeout_expired(void* data) {
+
+    struct Process* process = (struct Process*) data;
+
+    process->schedule.timedOut = 1;
+    // Takes it out of whatever it was waiting on, if anything
+    process_table_unblock(process);
+}
@@ -5,16 +5,32 @@
 
 struct Process* process_table_new(EntryPoint entryPoint, char* args, struct Process* parent, int kernel, int terminal, int active);
 
+struct Process* process_table_new_thread(struct Process* leader, ThreadStart start, void* entry, void* arg);
+
+void process_table_reap_thread(struct Process* thread);
+
 void process_table_exit(struct Process* process);
 
-pid_t process_table_wait(struct Process* process);
+pid_t process_table_wait(struct Process* process, size_t timeout);
 
 struct Process* process_table_get(pid_t pid);
 
+struct Process* process_table_first(void);
+
+struct Process* process_table_next(struct Process* process);
+
 void process_table_block(struct Process* process);
 
 void process_table_unblock(struct Process* process);
 
-void process_table_kill(struct Process* process);
+void process_table_wait_on(struct Process* process, struct ProcessQueue* queue);
+
+void process_table_wake(struct ProcessQueue* queue);
+
+int process_table_kill(struct Process* process);
+
+void process_table_timeout(struct Process* process, size_t ticks);
+
+void process_table_sleep(struct Process* process, size_t ticks);
 
 #endif
@@ -1,100 +1,53 @@
 #include "system/processQueue.h"
+#include "system/process/process.h"
 #include "type.h"
 
-#define QUEUE_SIZE      256
-
-static struct QueueNode* freeNodes = NULL;
-
-static void free_node(struct QueueNode* node);
-
-static struct QueueNode* alloc_node(void);
-
-void free_node(struct QueueNode* node) {
-    node->next = freeNodes;
-    freeNodes = node;
-}
-
-struct QueueNode* alloc_node(void) {
-
-    struct QueueNode* node;
-    if (freeNodes == NULL) {
-        node = kalloc(sizeof(struct QueueNode));
-        if (node == NULL) {
-            return NULL;
-        }
-    } else {
-        node = freeNodes;
-        freeNodes = node->next;
-    }
-
-    return node;
-}
-
 void process_queue_push(struct ProcessQueue* queue, struct Process* process) {
 
-    struct QueueNode* node = alloc_node();
-    node->process = process;
-    node->acumPriority = 1;
+    process->queue = queue;
+    process->queueNext = NULL;
+    process->queuePrev = queue->last;
 
     if (queue->first == NULL) {
-        queue->first = queue->last = node;
+        queue->first = queue->last = process;
     } else {
-        queue->last->next = node;
-        queue->last = node;
+        queue->last->queueNext = process;
+        queue->last = process;
     }
 
-    node->next = NULL;
+    queue->size++;
 }
 
 struct Process* process_queue_pop(struct ProcessQueue* queue) {
-    
-    if (queue->first == NULL) {
+
+    struct Process* process = queue->first;
+    if (process == NULL) {
         return NULL;
     }
-    
-    struct Process* process = queue->first->process;
-    struct QueueNode* aux = queue->first;
-    
-    if (queue->first == queue->last) {
-        queue->first = queue->last = NULL;
-    } else {
-        queue->first = queue->first->next;
-    }
-    
-    free_node(aux);
+
+    process_queue_remove(queue, process);
     return process;
 }
 
 void process_queue_remove(struct ProcessQueue* queue, struct Process* process) {
 
-    struct QueueNode* prev = NULL;
-    struct QueueNode* node = NULL;
-
-    if (queue->first == NULL) {
+    if (process->queue != queue) {
         return;
     }
 
-    node = queue->first;
-    while (node != NULL) {
-
-        if (node->process->pid == process->pid) {
-
-            if (queue->last == node) {
-                queue->last = prev;
-            }
-
-            if (prev != NULL) {
-                prev->next = node->next;
-            } else {
-                queue->first = node->next;
-            }
-
-            free_node(node);
-            return;
-        }
+    if (process->queuePrev != NULL) {
+        process->queuePrev->queueNext = process->queueNext;
+    } else {
+        queue->first = process->queueNext;
+    }
 
-        prev = node;
-        node = node->next;
+    if (process->queueNext != NULL) {
+        process->queueNext->queuePrev = process->queuePrev;
+    } else {
+        queue->last = process->queuePrev;
     }
-}
 
+    process->queue = NULL;
+    process->queuePrev = process->queueNext = NULL;
+    queue->size--;
+}
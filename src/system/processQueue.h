@@ -1,18 +1,20 @@
 #ifndef __SYSTEM_PROCESS_QUEUE_
 #define __SYSTEM_PROCESS_QUEUE_
 
-#include "system/process/process.h"
 #include "type.h"
 
-struct QueueNode{
-    struct QueueNode* next;
-    struct Process* process;
-    int acumPriority;
-};
+struct Process;
 
+/**
+ * A FIFO of processes, linked through the processes themselves.
+ *
+ * A process can be in a single queue at a time, either the ready queue or
+ * the wait queue of whatever it's blocked on.
+ */
 struct ProcessQueue {
-    struct QueueNode* first;
-    struct QueueNode* last;
+    struct Process* first;
+    struct Process* last;
+    size_t size;
 };
 
 void process_queue_push(struct ProcessQueue* queue, struct Process* process);
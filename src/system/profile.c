@@ -0,0 +1,138 @@
+#include "system/profile.h"
+#include "system/call.h"
+#include "system/timer.h"
+#include "system/scheduler.h"
+#include "system/smp.h"
+#include "system/mm.h"
+#include "library/stdlib.h"
+
+#define PROFILE_MASK (PROFILE_SAMPLES - 1)
+
+#define RING_PAGES ((PROFILE_SAMPLES * sizeof(struct ProfileSample) + PAGE_SIZE - 1) / PAGE_SIZE)
+
+static volatile int enabled = 0;
+
+static void start(void);
+
+static size_t read_samples(struct ProfileRing* ring, struct ProfileSample* buffer, size_t max);
+
+/**
+ * Record where the timer interrupted, and who was running, in this CPU's ring.
+ *
+ * Called from the timer interrupt. When the ring is full the sample is
+ * dropped, rather than overwriting ones the reader might be copying.
+ *
+ * @param eip The interrupted instruction.
+ */
+void profile_sample(unsigned int eip) {
+
+    if (!enabled) {
+        return;
+    }
+
+    struct Cpu* cpu = smp_cpu();
+    struct ProfileRing* ring = &cpu->profile;
+
+    if (ring->samples == NULL || ring->head - ring->tail == PROFILE_SAMPLES) {
+        ring->dropped++;
+        return;
+    }
+
+    struct Process* process = cpu->curr;
+    struct ProfileSample* sample = &ring->samples[ring->head & PROFILE_MASK];
+
+    sample->eip = eip;
+    sample->pid = process ? process->pid : 0;
+    sample->cpu = cpu->index;
+
+    ring->head++;
+}
+
+/**
+ * Empty every CPU's ring, giving one to those that don't have it yet.
+ *
+ * A CPU that can't get one drops its samples.
+ */
+void start(void) {
+
+    for (unsigned int i = 0; i < smp_cpu_count; i++) {
+
+        struct ProfileRing* ring = &smp_cpus[i].profile;
+        if (ring->samples == NULL) {
+            ring->samples = allocPages(RING_PAGES);
+        }
+
+        ring->head = ring->tail = 0;
+        ring->dropped = 0;
+    }
+}
+
+size_t read_samples(struct ProfileRing* ring, struct ProfileSample* buffer, size_t max) {
+
+    size_t count = ring->head - ring->tail;
+    if (count > max) {
+        count = max;
+    }
+
+    for (size_t i = 0; i < count; i++) {
+        buffer[i] = ring->samples[(ring->tail + i) & PROFILE_MASK];
+    }
+
+    ring->tail += count;
+
+    return count;
+}
+
+/**
+ * System call that controls the sampling profiler.
+ *
+ * PROFILE_START throws away whatever was left and starts sampling,
+ * PROFILE_STOP stops it. PROFILE_READ moves samples out of the CPUs'
+ * rings into buffer, one CPU after the other. PROFILE_DROPPED tells how
+ * many didn't fit, on all of them, since the last start.
+ *
+ * @param cmd One of the PROFILE_ commands.
+ * @param buffer Where PROFILE_READ stores the samples.
+ * @param length The size of buffer in bytes.
+ *
+ * @return The samples read for PROFILE_READ, the samples dropped for
+ *         PROFILE_DROPPED, 0 otherwise. -1 if cmd is not known.
+ */
+int _profile(int cmd, void* buffer, size_t length) {
+
+    size_t read = 0;
+
+    switch (cmd) {
+        case PROFILE_START:
+            enabled = 0;
+            start();
+            enabled = 1;
+            timer_sampling(PROFILE_HZ);
+            return 0;
+
+        case PROFILE_STOP:
+            enabled = 0;
+            timer_sampling(0);
+            return 0;
+
+        case PROFILE_READ:
+            if (buffer == NULL) {
+                return -1;
+            }
+            for (unsigned int i = 0; i < smp_cpu_count && length >= sizeof(struct ProfileSample); i++) {
+                size_t count = read_samples(&smp_cpus[i].profile, buffer, length / sizeof(struct ProfileSample));
+                buffer = (struct ProfileSample*) buffer + count;
+                length -= count * sizeof(struct ProfileSample);
+                read += count;
+            }
+            return read;
+
+        case PROFILE_DROPPED:
+            for (unsigned int i = 0; i < smp_cpu_count; i++) {
+                read += smp_cpus[i].profile.dropped;
+            }
+            return read;
+    }
+
+    return -1;
+}
@@ -0,0 +1,26 @@
+#ifndef __SYSTEM_PROFILE__
+#define __SYSTEM_PROFILE__
+
+#include "type.h"
+
+// Samples per second when there's a timer to spare for the profiler
+#define PROFILE_HZ 1000
+
+// Samples each CPU keeps until they're read, must be a power of two
+#define PROFILE_SAMPLES 8192
+
+/**
+ * The samples one CPU took. It's the only one that moves head, and the
+ * reader the only one that moves tail, both with the kernel lock held.
+ */
+struct ProfileRing {
+    // Allocated the first time the profiler starts
+    struct ProfileSample* samples;
+    volatile size_t head;
+    volatile size_t tail;
+    size_t dropped;
+};
+
+void profile_sample(unsigned int eip);
+
+#endif
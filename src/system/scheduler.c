@@ -1,68 +1,535 @@
 #include "system/scheduler.h"
-#include "system/scheduler/choose_next.h"
+#include "system/scheduler/class.h"
 #include "system/processQueue.h"
+#include "system/paging.h"
+#include "system/timer.h"
+#include "system/fpu.h"
+#include "system/pmu.h"
+#include "system/cpu.h"
+#include "system/smp.h"
+#include "system/deadline.h"
+#include "system/process/table.h"
 #include "type.h"
 
-struct ProcessQueue scheduler_queue = {.first = NULL, .last = NULL};
+// Timer ticks a process runs for before it's preempted
+#define QUANTUM_TICKS ((HZ / 20) ? (HZ / 20) : 1)
 
-struct Process* scheduler_curr = NULL;
+// An idle CPU only takes work from one that has more than this queued
+#define STEAL_THRESHOLD 2
+
+// Run queues live in struct Cpu. They only hold runnable processes, blocked
+// ones sit in the wait queue of whatever they wait for. Processes in the
+// deadline class aren't in them either, they're in the class' own heaps.
+// The classes keep their own structures besides, to choose from.
+
+static const struct SchedulerClass* const policies[SCHED_POLICIES] = {
+    [SCHED_ROUND_ROBIN] = &round_robin_class,
+    [SCHED_PRIORITY] = &priority_class,
+    [SCHED_MULTILEVEL] = &multilevel_class,
+    [SCHED_FAIR] = &fair_class
+};
+
+// What processes that didn't choose a policy follow
+static int defaultPolicy = SCHED_ROUND_ROBIN;
+
+// The order policies are asked in, the first one with a runnable process
+// gets the CPU. Priority ones go first, and round robin, which every
+// process follows unless it asks for something else, goes last.
+static const struct SchedulerClass* const precedence[SCHED_POLICIES] = {
+    &priority_class, &multilevel_class, &fair_class, &round_robin_class
+};
 
 union longlong {
     struct timeStampCounte { int low; int high; } tsc;
     unsigned long long val;
 };
 
-static unsigned long long cycles = 0;
+static void update_cycles(struct Cpu* cpu);
+
+static struct Cpu* least_loaded(void);
+
+static void steal(struct Cpu* cpu);
+
+static void pick_next(struct Cpu* cpu);
+
+static const struct SchedulerClass* class_of(struct Process* process);
+
+static int runnable(struct Process* process);
+
+static void enqueue(struct Process* process);
+
+static void dequeue(struct Process* process);
+
+const struct SchedulerClass* class_of(struct Process* process) {
+
+    if (process->dl.active) {
+        return &deadline_class;
+    }
+
+    int policy = process->schedule.policy;
+    return policies[policy == SCHED_DEFAULT ? defaultPolicy : policy];
+}
+
+int runnable(struct Process* process) {
+
+    if (process->dl.active) {
+        return process->dl.runnable;
+    }
 
-static void update_cycles(void);
+    return process->queue == &smp_cpus[process->cpu].runQueue;
+}
+
+/**
+ * Make a process runnable on the CPU in process->cpu.
+ *
+ * Idle processes are only in the run queue, no class picks them.
+ */
+void enqueue(struct Process* process) {
+
+    struct Cpu* cpu = &smp_cpus[process->cpu];
+
+    if (!process->dl.active) {
+        process_queue_push(&cpu->runQueue, process);
+    }
+
+    if (process != cpu->idle) {
+        class_of(process)->enqueue(process);
+    }
+}
+
+void dequeue(struct Process* process) {
+
+    struct Cpu* cpu = &smp_cpus[process->cpu];
+
+    process_queue_remove(&cpu->runQueue, process);
+
+    if (process != cpu->idle) {
+        class_of(process)->dequeue(process);
+    }
+}
+
+/**
+ * The online CPU with the fewest runnable processes, preferring this one on ties.
+ */
+struct Cpu* least_loaded(void) {
+
+    struct Cpu* best = smp_cpu();
+
+    for (unsigned int i = 0; i < smp_cpu_count; i++) {
+        struct Cpu* cpu = &smp_cpus[i];
+        if (cpu->online && cpu->runQueue.size < best->runQueue.size) {
+            best = cpu;
+        }
+    }
+
+    return best;
+}
 
+/**
+ * Move a ready process over from the busiest CPU, if this one has nothing but its idle process.
+ *
+ * Processes whose FPU state is still loaded on their CPU are left alone,
+ * the state would have to be saved from there first.
+ *
+ * @param cpu This CPU.
+ */
+void steal(struct Cpu* cpu) {
+
+    if (cpu->runQueue.size > 1) {
+        return;
+    }
+
+    struct Cpu* busiest = NULL;
+    for (unsigned int i = 0; i < smp_cpu_count; i++) {
+        struct Cpu* other = &smp_cpus[i];
+        if (other != cpu && other->online && other->runQueue.size > STEAL_THRESHOLD &&
+                (busiest == NULL || other->runQueue.size > busiest->runQueue.size)) {
+            busiest = other;
+        }
+    }
+
+    if (busiest == NULL) {
+        return;
+    }
+
+    for (struct Process* p = busiest->runQueue.first; p != NULL; p = p->queueNext) {
+
+        if (p == busiest->curr || p == busiest->fpuOwner || p->schedule.pinned ||
+                p->schedule.status != StatusReady) {
+            continue;
+        }
+
+        // The policy keeps its state per CPU too, so it's told on both ends
+        dequeue(p);
+        p->cpu = cpu->index;
+        enqueue(p);
+
+        return;
+    }
+}
+
+/**
+ * Choose what this CPU runs next.
+ *
+ * The deadline class goes first, then the policies in precedence order.
+ * A policy only gets the CPU when the ones before it have nothing to run,
+ * however many processes each has, so a process picks a policy above
+ * round robin to go ahead of the ones that didn't. The idle process only
+ * runs when none of them has anything.
+ *
+ * @param cpu This CPU.
+ */
+void pick_next(struct Cpu* cpu) {
+
+    struct Process* prev = cpu->curr;
+
+    if (prev != NULL) {
+        if (prev->schedule.status == StatusRunning) {
+            prev->schedule.status = StatusReady;
+        }
+        if (prev != cpu->idle) {
+            class_of(prev)->put_prev(prev);
+        }
+    }
+
+    struct Process* next = deadline_class.pick_next(cpu);
+
+    for (unsigned int i = 0; next == NULL && i < SCHED_POLICIES; i++) {
+        next = precedence[i]->pick_next(cpu);
+    }
+
+    if (next == NULL && cpu->idle != NULL && cpu->idle->schedule.status != StatusBlocked) {
+        next = cpu->idle;
+    }
+
+    cpu->curr = next;
+    if (next != NULL) {
+        next->schedule.status = StatusRunning;
+    }
+}
+
+/**
+ * Make a new process runnable.
+ *
+ * The first process a CPU creates is its idle process, and stays there.
+ * The rest go to whichever CPU has the least to do.
+ *
+ * @param process The process.
+ */
 void scheduler_add(struct Process* process) {
-    process_queue_push(&scheduler_queue, process);
+
+    struct Cpu* cpu = smp_cpu();
+
+    if (cpu->idle == NULL) {
+        cpu->idle = process;
+        process->schedule.pinned = 1;
+    } else {
+        cpu = least_loaded();
+    }
+
+    process->cpu = cpu->index;
+    enqueue(process);
+
+    if (cpu != smp_cpu()) {
+        smp_kick(cpu);
+    }
 }
 
 void scheduler_do(void) {
 
-    if (scheduler_curr != NULL) {
-        __asm__ __volatile ("mov %%ebp, %0":"=r"(scheduler_curr->mm.esp)::);
-        update_cycles();
+    struct Cpu* cpu = smp_cpu();
+    struct Process* prev = cpu->curr;
+
+    if (prev != NULL) {
+        __asm__ __volatile ("mov %%ebp, %0":"=r"(prev->mm.esp)::);
+        update_cycles(cpu);
+        pmu_account(prev);
+    } else {
+        cpu->cycles = rdtsc();
+    }
+
+    steal(cpu);
+    pick_next(cpu);
+
+    if (prev != NULL && prev != cpu->curr) {
+        // If it could have kept running, it was preempted
+        if (prev->schedule.status == StatusReady && !cpu->yielded) {
+            prev->involuntarySwitches++;
+        } else {
+            prev->voluntarySwitches++;
+        }
+        prev->readySince = rdtsc();
+    }
+
+    if (cpu->curr != NULL && cpu->curr != prev) {
+        cpu->curr->waitCycles += rdtsc() - cpu->curr->readySince;
+    }
+
+    cpu->needResched = 0;
+    cpu->yielded = 0;
+    cpu->quantumLeft = QUANTUM_TICKS;
+
+    fpu_switch(cpu->curr);
+
+    if (cpu->curr != NULL) {
+        paging_switch(process_space(cpu->curr));
+        __asm__ __volatile__ ("mov %0, %%ebp"::"r"(cpu->curr->mm.esp));
     }
+}
+
+/**
+ * Switch processes if something asked for it since the last switch.
+ *
+ * Called at the end of every interrupt, so plain syscalls don't switch.
+ * It's also where a process killed from another CPU finally goes away.
+ */
+void scheduler_preempt(void) {
 
-    choose_next();
+    struct Cpu* cpu = smp_cpu();
 
-    if (scheduler_curr != NULL) {
-        __asm__ __volatile__ ("mov %0, %%ebp"::"r"(scheduler_curr->mm.esp));
+    if (cpu->curr != NULL && cpu->curr->schedule.killed) {
+        process_table_kill(cpu->curr);
+    }
+
+    if (cpu->needResched || cpu->curr == NULL) {
+        scheduler_do();
+    }
+}
+
+/**
+ * Account a timer tick to the current process, and preempt it once its quantum is over.
+ *
+ * The idle process is always preempted, so an idle CPU looks for work to steal on every tick.
+ */
+void scheduler_tick(void) {
+
+    struct Cpu* cpu = smp_cpu();
+
+    if (cpu->quantumLeft > 0) {
+        cpu->quantumLeft--;
+    }
+
+    if (cpu->quantumLeft == 0 || cpu->curr == cpu->idle) {
+        cpu->needResched = 1;
+    }
+
+    if (cpu->curr != NULL && cpu->curr != cpu->idle && class_of(cpu->curr)->tick != NULL) {
+        class_of(cpu->curr)->tick(cpu->curr);
+    }
+}
+
+/**
+ * Give up the rest of the quantum, on the way out of the current interrupt.
+ */
+void scheduler_yield(void) {
+
+    struct Cpu* cpu = smp_cpu();
+
+    cpu->yielded = 1;
+    cpu->needResched = 1;
+
+    if (cpu->curr != NULL && cpu->curr != cpu->idle && class_of(cpu->curr)->yield != NULL) {
+        class_of(cpu->curr)->yield(cpu->curr);
     }
 }
 
 void scheduler_remove(struct Process* process) {
-    if (scheduler_curr != NULL && process->pid == scheduler_curr->pid) {
-        scheduler_curr = NULL;
+
+    struct Cpu* cpu = &smp_cpus[process->cpu];
+
+    if (process == cpu->curr) {
+        cpu->curr = NULL;
+        smp_kick(cpu);
+    }
+
+    dequeue(process);
+
+    if (process->dl.active) {
+        deadline_release(process);
+        process->dl.active = 0;
+    }
+}
+
+/**
+ * Move a process in or out of the deadline class.
+ *
+ * If it was runnable, it stays so in the other one. The CPU it's on
+ * goes through the scheduler, since what should run there may have changed.
+ *
+ * @param process The process.
+ * @param active Whether it goes in the class.
+ */
+void scheduler_set_deadline(struct Process* process, int active) {
+
+    int wasRunnable = runnable(process);
+
+    if (wasRunnable) {
+        dequeue(process);
+    }
+
+    process->dl.active = active;
+
+    if (wasRunnable) {
+        enqueue(process);
+        smp_kick(&smp_cpus[process->cpu]);
+    }
+}
+
+/**
+ * Choose the policy of a process.
+ *
+ * @param process The process.
+ * @param policy One of the SCHED_ policies, or SCHED_DEFAULT to follow the system's.
+ */
+void scheduler_set_policy(struct Process* process, int policy) {
+
+    int wasRunnable = runnable(process);
+
+    if (wasRunnable) {
+        dequeue(process);
+    }
+
+    process->schedule.policy = policy;
+
+    if (wasRunnable) {
+        enqueue(process);
+        smp_kick(&smp_cpus[process->cpu]);
     }
-    process_queue_remove(&scheduler_queue, process);
 }
 
+/**
+ * Change the priority a process runs at.
+ *
+ * A runnable process is queued again, so its policy takes the new one into account.
+ *
+ * @param process The process.
+ * @param priority From 0 to PRIORITY_LEVELS - 1.
+ */
+void scheduler_set_priority(struct Process* process, int priority) {
+
+    int wasRunnable = runnable(process);
+
+    if (wasRunnable) {
+        dequeue(process);
+    }
+
+    process->schedule.priority = priority;
+
+    if (wasRunnable) {
+        enqueue(process);
+        smp_kick(&smp_cpus[process->cpu]);
+    }
+}
+
+/**
+ * Change the policy of every process that follows the system's.
+ *
+ * Those that are runnable move over right away, the rest when they're woken up.
+ *
+ * @param policy One of the SCHED_ policies.
+ */
+void scheduler_set_default(int policy) {
+
+    struct Process* process;
+
+    // Each one has to leave through the class it was in, before it's changed
+    for (process = process_table_first(); process != NULL; process = process_table_next(process)) {
+        if (process->schedule.policy == SCHED_DEFAULT && !process->dl.active && runnable(process)) {
+            dequeue(process);
+            // Out of every queue, that's how it's found again below
+            process->schedule.switching = 1;
+        }
+    }
+
+    defaultPolicy = policy;
+
+    for (process = process_table_first(); process != NULL; process = process_table_next(process)) {
+        if (process->schedule.switching) {
+            process->schedule.switching = 0;
+            enqueue(process);
+        }
+    }
+
+    for (unsigned int i = 0; i < smp_cpu_count; i++) {
+        if (smp_cpus[i].online) {
+            smp_kick(&smp_cpus[i]);
+        }
+    }
+}
+
+int scheduler_get_default(void) {
+    return defaultPolicy;
+}
+
+/**
+ * What a process is scheduled by, SCHED_DEADLINE or one of the policies.
+ */
+int scheduler_policy(struct Process* process) {
+
+    if (process->dl.active) {
+        return SCHED_DEADLINE;
+    }
+
+    return process->schedule.policy == SCHED_DEFAULT ? defaultPolicy : process->schedule.policy;
+}
+
+/**
+ * Make a blocked process runnable again, on the CPU it last ran on.
+ *
+ * That CPU is kicked if it's idle, or if the process is more urgent than
+ * what it's running.
+ *
+ * @param process The process.
+ */
 void scheduler_unblock(struct Process* process) {
-    process_queue_push(&scheduler_queue, process);
+
+    struct Cpu* cpu = &smp_cpus[process->cpu];
+
+    process->readySince = rdtsc();
+    enqueue(process);
+
+    // The deadline class kicks the CPU itself, if the process should preempt
+    if (process->dl.active) {
+        return;
+    }
+
+    if (cpu->curr == NULL || cpu->curr == cpu->idle || (!cpu->curr->dl.active &&
+            process->schedule.priority > cpu->curr->schedule.priority)) {
+        smp_kick(cpu);
+    }
 }
 
 void scheduler_block(struct Process* process) {
-    process_queue_remove(&scheduler_queue, process);
+
+    struct Cpu* cpu = &smp_cpus[process->cpu];
+
+    dequeue(process);
+
+    if (process == cpu->curr) {
+        smp_kick(cpu);
+    }
 }
 
 struct Process* scheduler_current(void) {
-    if (scheduler_curr == NULL) {
-        return NULL;
-    }
+    return smp_cpu()->curr;
+}
 
-    return scheduler_curr;
+/**
+ * Number of processes that can run on this CPU, including the current one.
+ */
+size_t scheduler_runnable(void) {
+    return smp_cpu()->runQueue.size + deadline_runnable(smp_cpu());
 }
 
+/**
+ * When this CPU last charged cycles to a process.
+ */
 unsigned long long scheduler_get_cycles(void) {
-    return cycles;
+    return smp_cpu()->cycles;
 }
 
 
-void update_cycles(void) {
+void update_cycles(struct Cpu* cpu) {
 
     union longlong a;
     unsigned long long newCycles;
@@ -71,9 +538,6 @@ void update_cycles(void) {
 
     newCycles = a.val;
 
-    scheduler_curr->cycles += (newCycles - cycles);
-    cycles = newCycles;
+    cpu->curr->cycles += (newCycles - cpu->cycles);
+    cpu->cycles = newCycles;
 }
-
-
-
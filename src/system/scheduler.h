@@ -3,23 +3,45 @@
 
 #include "system/processQueue.h"
 #include "system/process/process.h"
+#include "system/smp.h"
 
-extern struct ProcessQueue scheduler_queue;
+// Each CPU has its own, the policies in system/scheduler only ever see the one they run on
+#define scheduler_queue (smp_cpu()->runQueue)
 
-extern struct Process* scheduler_curr;
+#define scheduler_curr (smp_cpu()->curr)
 
 void scheduler_add(struct Process* process);
 
 void scheduler_do(void);
 
+void scheduler_preempt(void);
+
+void scheduler_tick(void);
+
+void scheduler_yield(void);
+
 void scheduler_remove(struct Process* process);
 
 struct Process* scheduler_current(void);
 
 unsigned long long scheduler_get_cycles(void);
 
+size_t scheduler_runnable(void);
+
 void scheduler_unblock(struct Process* process);
 
 void scheduler_block(struct Process* process);
+
+void scheduler_set_deadline(struct Process* process, int active);
+
+void scheduler_set_policy(struct Process* process, int policy);
+
+void scheduler_set_priority(struct Process* process, int priority);
+
+void scheduler_set_default(int policy);
+
+int scheduler_get_default(void);
+
+int scheduler_policy(struct Process* process);
 #endif
 
@@ -1,7 +0,0 @@
-#ifndef __SYSTEM_SCHEDULER_CHOOSENEXT_
-#define __SYSTEM_SCHEDULER_CHOOSENEXT_
-
-void choose_next(void);
-
-#endif
-
@@ -0,0 +1,44 @@
+#ifndef __SYSTEM_SCHEDULER_CLASS__
+#define __SYSTEM_SCHEDULER_CLASS__
+
+#include "system/process/process.h"
+#include "system/smp.h"
+
+/**
+ * A scheduling policy.
+ *
+ * Each one keeps its runnable processes in whatever it needs, once per CPU,
+ * and processes are in the one of process->cpu. The running process is
+ * taken out when it's picked, and given back with put_prev when it's
+ * switched out. Idle processes are never handed to them.
+ *
+ * Everything is called with the kernel lock held. tick and yield may be
+ * NULL for policies that don't care.
+ */
+struct SchedulerClass {
+    const char* name;
+    // The process became runnable, or joined the class while it was
+    void (*enqueue)(struct Process* process);
+    // It blocked, exited, or is leaving the class
+    void (*dequeue)(struct Process* process);
+    // Take back the running process, it's Ready if it can still run
+    void (*put_prev)(struct Process* process);
+    // Take out the process a CPU runs next, NULL if it has none
+    struct Process* (*pick_next)(struct Cpu* cpu);
+    // A timer tick went by while process ran, it may set needResched
+    void (*tick)(struct Process* process);
+    // The running process gave up the rest of its turn
+    void (*yield)(struct Process* process);
+};
+
+extern const struct SchedulerClass round_robin_class;
+
+extern const struct SchedulerClass priority_class;
+
+extern const struct SchedulerClass multilevel_class;
+
+extern const struct SchedulerClass fair_class;
+
+extern const struct SchedulerClass deadline_class;
+
+#endif
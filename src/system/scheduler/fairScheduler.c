@@ -0,0 +1,593 @@
+#include "system/scheduler/class.h"
+#include "system/timer.h"
+#include "system/cpu.h"
+#include "library/div64.h"
+#include "type.h"
+
+// The weight of a nice 0 process, vruntime advances at the speed of the TSC for it
+#define NICE_0_WEIGHT 1024
+
+// Each nice level is worth about 10% of CPU time over the next one
+static const unsigned long niceToWeight[40] = {
+    88761, 71755, 56483, 46273, 36291,
+    29154, 23254, 18705, 14949, 11916,
+    9548,  7620,  6100,  4904,  3906,
+    3121,  2501,  1991,  1586,  1277,
+    1024,  820,   655,   526,   423,
+    335,   272,   215,   172,   137,
+    110,   87,    70,    56,    45,
+    36,    29,    23,    18,    15
+};
+
+#define LEFT(p) ((p)->schedule.rbLeft)
+#define RIGHT(p) ((p)->schedule.rbRight)
+#define PARENT(p) ((p)->schedule.rbParent)
+#define IS_RED(p) ((p) != NULL && (p)->schedule.rbRed)
+
+// Each CPU has its own tree, processes are in the one of process->cpu.
+// The running process is taken out of it, but still counts for the load.
+struct FairQueue {
+    struct Process* root;
+    // Cached, it's the next one to run
+    struct Process* leftmost;
+    // Never goes back, new and waking processes are placed relative to it
+    unsigned long long minVruntime;
+    unsigned long totalWeight;
+    size_t running;
+};
+
+static struct FairQueue queues[SMP_MAX_CPUS];
+
+static void enqueue(struct Process* process);
+
+static void dequeue(struct Process* process);
+
+static void put_prev(struct Process* process);
+
+static struct Process* pick_next(struct Cpu* cpu);
+
+static void tick(struct Process* process);
+
+static void yield(struct Process* process);
+
+static int before(unsigned long long a, unsigned long long b);
+
+static unsigned long long to_cycles(unsigned long long ns);
+
+static unsigned long weight_of(struct Process* process);
+
+static void update_curr(struct Process* process);
+
+static void update_min(struct FairQueue* queue, struct Process* curr);
+
+static void place(struct FairQueue* queue, struct Process* process);
+
+static unsigned long long slice(struct FairQueue* queue, struct Process* process);
+
+static void replace_child(struct FairQueue* queue, struct Process* parent, struct Process* old, struct Process* new);
+
+static void rotate_left(struct FairQueue* queue, struct Process* node);
+
+static void rotate_right(struct FairQueue* queue, struct Process* node);
+
+static struct Process* minimum(struct Process* node);
+
+static void tree_insert(struct FairQueue* queue, struct Process* process);
+
+static void insert_fixup(struct FairQueue* queue, struct Process* node);
+
+static void tree_erase(struct FairQueue* queue, struct Process* process);
+
+static void erase_fixup(struct FairQueue* queue, struct Process* node, struct Process* parent);
+
+// Each process gets CPU time in proportion to its weight, the one that got the least runs
+const struct SchedulerClass fair_class = {
+    "fair", enqueue, dequeue, put_prev, pick_next, tick, yield
+};
+
+/**
+ * Compare vruntimes, so that it still works once they wrap around.
+ */
+int before(unsigned long long a, unsigned long long b) {
+    return (long long) (a - b) < 0;
+}
+
+unsigned long long to_cycles(unsigned long long ns) {
+    return uint64_div64(ns * timer_cycles_per_second(), NSEC_PER_SEC);
+}
+
+/**
+ * The share of the CPU a process gets, relative to NICE_0_WEIGHT.
+ *
+ * It goes by the priority it runs at, so a process that holds others up
+ * gets the share they would.
+ */
+unsigned long weight_of(struct Process* process) {
+    int nice = NICE_MAX - process->schedule.priority;
+    return niceToWeight[nice - NICE_MIN];
+}
+
+/**
+ * Charge a running process for the cycles since its vruntime was last updated.
+ *
+ * @param process The process, which is running.
+ */
+void update_curr(struct Process* process) {
+
+    unsigned long long now = rdtsc();
+    unsigned long long delta = now - process->schedule.execStart;
+
+    process->schedule.execStart = now;
+
+    if (process->schedule.weight != NICE_0_WEIGHT) {
+        delta = uint64_div64(delta * NICE_0_WEIGHT, process->schedule.weight);
+    }
+    process->schedule.vruntime += delta;
+}
+
+/**
+ * Move minVruntime up to the smallest vruntime that can run.
+ *
+ * @param queue The CPU's queue.
+ * @param curr The process running there, NULL if it's not in this policy.
+ */
+void update_min(struct FairQueue* queue, struct Process* curr) {
+
+    unsigned long long vruntime = queue->minVruntime;
+    int found = 0;
+
+    if (curr != NULL) {
+        vruntime = curr->schedule.vruntime;
+        found = 1;
+    }
+
+    if (queue->leftmost != NULL &&
+            (!found || before(queue->leftmost->schedule.vruntime, vruntime))) {
+        vruntime = queue->leftmost->schedule.vruntime;
+        found = 1;
+    }
+
+    if (found && before(queue->minVruntime, vruntime)) {
+        queue->minVruntime = vruntime;
+    }
+}
+
+/**
+ * Pick the vruntime of a process that becomes runnable.
+ *
+ * New processes start at the minimum, so they can't take over the CPU.
+ * Sleepers get at most half a latency period of credit, which is what
+ * lets an interactive process preempt CPU bound ones as soon as it wakes up.
+ * Processes coming from another CPU are brought into this one's range.
+ *
+ * @param queue The queue it goes into.
+ * @param process The process.
+ */
+void place(struct FairQueue* queue, struct Process* process) {
+
+    unsigned long long latency = to_cycles(SCHED_LATENCY_NS);
+    unsigned long long lowest = queue->minVruntime - latency / 2;
+    unsigned long long highest = queue->minVruntime + latency;
+
+    if (process->cycles == 0) {
+        process->schedule.vruntime = queue->minVruntime;
+    } else if (before(process->schedule.vruntime, lowest)) {
+        process->schedule.vruntime = lowest;
+    } else if (before(highest, process->schedule.vruntime)) {
+        process->schedule.vruntime = highest;
+    }
+}
+
+/**
+ * How long a process may run before it's preempted, in TSC cycles.
+ *
+ * The latency period is split by weight, and stretched when there are so
+ * many processes that the slices would go below the minimum granularity.
+ *
+ * @param queue The queue of the CPU it runs on.
+ * @param process The process.
+ */
+unsigned long long slice(struct FairQueue* queue, struct Process* process) {
+
+    unsigned long long granularity = to_cycles(SCHED_MIN_GRANULARITY_NS);
+    unsigned long long period = to_cycles(SCHED_LATENCY_NS);
+
+    if (queue->running > SCHED_LATENCY_NS / SCHED_MIN_GRANULARITY_NS) {
+        period = granularity * queue->running;
+    }
+
+    unsigned long long cycles = uint64_div64(period * process->schedule.weight, queue->totalWeight);
+    return cycles < granularity ? granularity : cycles;
+}
+
+void replace_child(struct FairQueue* queue, struct Process* parent, struct Process* old, struct Process* new) {
+
+    if (parent == NULL) {
+        queue->root = new;
+    } else if (LEFT(parent) == old) {
+        LEFT(parent) = new;
+    } else {
+        RIGHT(parent) = new;
+    }
+
+    if (new != NULL) {
+        PARENT(new) = parent;
+    }
+}
+
+void rotate_left(struct FairQueue* queue, struct Process* node) {
+
+    struct Process* right = RIGHT(node);
+
+    RIGHT(node) = LEFT(right);
+    if (LEFT(right) != NULL) {
+        PARENT(LEFT(right)) = node;
+    }
+
+    replace_child(queue, PARENT(node), node, right);
+    LEFT(right) = node;
+    PARENT(node) = right;
+}
+
+void rotate_right(struct FairQueue* queue, struct Process* node) {
+
+    struct Process* left = LEFT(node);
+
+    LEFT(node) = RIGHT(left);
+    if (RIGHT(left) != NULL) {
+        PARENT(RIGHT(left)) = node;
+    }
+
+    replace_child(queue, PARENT(node), node, left);
+    RIGHT(left) = node;
+    PARENT(node) = left;
+}
+
+struct Process* minimum(struct Process* node) {
+
+    while (LEFT(node) != NULL) {
+        node = LEFT(node);
+    }
+
+    return node;
+}
+
+/**
+ * Add a process to the tree. Equal vruntimes go to the right, so they run in FIFO order.
+ */
+void tree_insert(struct FairQueue* queue, struct Process* process) {
+
+    struct Process** link = &queue->root;
+    struct Process* parent = NULL;
+    int leftmost = 1;
+
+    while (*link != NULL) {
+        parent = *link;
+        if (before(process->schedule.vruntime, parent->schedule.vruntime)) {
+            link = &LEFT(parent);
+        } else {
+            link = &RIGHT(parent);
+            leftmost = 0;
+        }
+    }
+
+    PARENT(process) = parent;
+    LEFT(process) = RIGHT(process) = NULL;
+    process->schedule.rbRed = 1;
+    process->schedule.inTree = 1;
+    *link = process;
+
+    if (leftmost) {
+        queue->leftmost = process;
+    }
+
+    insert_fixup(queue, process);
+}
+
+/**
+ * Restore the red-black properties after inserting a red node.
+ */
+void insert_fixup(struct FairQueue* queue, struct Process* node) {
+
+    struct Process* parent;
+
+    while (IS_RED(parent = PARENT(node))) {
+
+        // A red node is never the root, so there's a grandparent
+        struct Process* grandparent = PARENT(parent);
+
+        if (parent == LEFT(grandparent)) {
+
+            struct Process* uncle = RIGHT(grandparent);
+            if (IS_RED(uncle)) {
+                parent->schedule.rbRed = uncle->schedule.rbRed = 0;
+                grandparent->schedule.rbRed = 1;
+                node = grandparent;
+                continue;
+            }
+
+            if (node == RIGHT(parent)) {
+                rotate_left(queue, parent);
+                node = parent;
+                parent = PARENT(node);
+            }
+
+            parent->schedule.rbRed = 0;
+            grandparent->schedule.rbRed = 1;
+            rotate_right(queue, grandparent);
+        } else {
+
+            struct Process* uncle = LEFT(grandparent);
+            if (IS_RED(uncle)) {
+                parent->schedule.rbRed = uncle->schedule.rbRed = 0;
+                grandparent->schedule.rbRed = 1;
+                node = grandparent;
+                continue;
+            }
+
+            if (node == LEFT(parent)) {
+                rotate_right(queue, parent);
+                node = parent;
+                parent = PARENT(node);
+            }
+
+            parent->schedule.rbRed = 0;
+            grandparent->schedule.rbRed = 1;
+            rotate_left(queue, grandparent);
+        }
+    }
+
+    queue->root->schedule.rbRed = 0;
+}
+
+void tree_erase(struct FairQueue* queue, struct Process* process) {
+
+    struct Process* child;
+    struct Process* parent;
+    int removedRed = process->schedule.rbRed;
+
+    if (queue->leftmost == process) {
+        // It has no left child, so the next one is either below or above it
+        queue->leftmost = RIGHT(process) ? minimum(RIGHT(process)) : PARENT(process);
+    }
+
+    if (LEFT(process) == NULL) {
+        child = RIGHT(process);
+        parent = PARENT(process);
+        replace_child(queue, parent, process, child);
+    } else if (RIGHT(process) == NULL) {
+        child = LEFT(process);
+        parent = PARENT(process);
+        replace_child(queue, parent, process, child);
+    } else {
+
+        // Take the successor out of its place, and put it where the process was
+        struct Process* successor = minimum(RIGHT(process));
+        removedRed = successor->schedule.rbRed;
+        child = RIGHT(successor);
+
+        if (PARENT(successor) == process) {
+            parent = successor;
+        } else {
+            parent = PARENT(successor);
+            replace_child(queue, parent, successor, child);
+            RIGHT(successor) = RIGHT(process);
+            PARENT(RIGHT(successor)) = successor;
+        }
+
+        replace_child(queue, PARENT(process), process, successor);
+        LEFT(successor) = LEFT(process);
+        PARENT(LEFT(successor)) = successor;
+        successor->schedule.rbRed = process->schedule.rbRed;
+    }
+
+    if (!removedRed) {
+        erase_fixup(queue, child, parent);
+    }
+
+    process->schedule.inTree = 0;
+    PARENT(process) = LEFT(process) = RIGHT(process) = NULL;
+}
+
+/**
+ * Restore the red-black properties after a black node was taken out.
+ *
+ * @param queue The queue.
+ * @param node What took its place, which carries an extra black. May be NULL.
+ * @param parent The parent of node, since node may be NULL.
+ */
+void erase_fixup(struct FairQueue* queue, struct Process* node, struct Process* parent) {
+
+    while (node != queue->root && !IS_RED(node)) {
+
+        // The extra black means the sibling can't be NULL
+        if (node == LEFT(parent)) {
+
+            struct Process* sibling = RIGHT(parent);
+            if (IS_RED(sibling)) {
+                sibling->schedule.rbRed = 0;
+                parent->schedule.rbRed = 1;
+                rotate_left(queue, parent);
+                sibling = RIGHT(parent);
+            }
+
+            if (!IS_RED(LEFT(sibling)) && !IS_RED(RIGHT(sibling))) {
+                sibling->schedule.rbRed = 1;
+                node = parent;
+                parent = PARENT(node);
+                continue;
+            }
+
+            if (!IS_RED(RIGHT(sibling))) {
+                LEFT(sibling)->schedule.rbRed = 0;
+                sibling->schedule.rbRed = 1;
+                rotate_right(queue, sibling);
+                sibling = RIGHT(parent);
+            }
+
+            sibling->schedule.rbRed = parent->schedule.rbRed;
+            parent->schedule.rbRed = 0;
+            RIGHT(sibling)->schedule.rbRed = 0;
+            rotate_left(queue, parent);
+        } else {
+
+            struct Process* sibling = LEFT(parent);
+            if (IS_RED(sibling)) {
+                sibling->schedule.rbRed = 0;
+                parent->schedule.rbRed = 1;
+                rotate_right(queue, parent);
+                sibling = LEFT(parent);
+            }
+
+            if (!IS_RED(LEFT(sibling)) && !IS_RED(RIGHT(sibling))) {
+                sibling->schedule.rbRed = 1;
+                node = parent;
+                parent = PARENT(node);
+                continue;
+            }
+
+            if (!IS_RED(LEFT(sibling))) {
+                RIGHT(sibling)->schedule.rbRed = 0;
+                sibling->schedule.rbRed = 1;
+                rotate_left(queue, sibling);
+                sibling = LEFT(parent);
+            }
+
+            sibling->schedule.rbRed = parent->schedule.rbRed;
+            parent->schedule.rbRed = 0;
+            LEFT(sibling)->schedule.rbRed = 0;
+            rotate_right(queue, parent);
+        }
+
+        node = queue->root;
+    }
+
+    if (node != NULL) {
+        node->schedule.rbRed = 0;
+    }
+}
+
+void enqueue(struct Process* process) {
+
+    struct Cpu* cpu = &smp_cpus[process->cpu];
+    struct FairQueue* queue = &queues[process->cpu];
+
+    if (process->schedule.counted) {
+        return;
+    }
+
+    process->schedule.weight = weight_of(process);
+    process->schedule.counted = 1;
+    queue->totalWeight += process->schedule.weight;
+    queue->running++;
+
+    place(queue, process);
+
+    // The running process goes back in the tree when it's switched out.
+    // It may have run outside the policy, that isn't charged to it.
+    if (process == cpu->curr) {
+        process->schedule.execStart = rdtsc();
+        return;
+    }
+
+    tree_insert(queue, process);
+
+    // Preempt whatever runs there if it's ahead by enough, which is what
+    // keeps wake up latency low for processes that mostly sleep
+    struct Process* curr = cpu->curr;
+    if (curr != NULL && curr != cpu->idle && curr->schedule.counted) {
+        update_curr(curr);
+        if (before(process->schedule.vruntime + to_cycles(SCHED_WAKEUP_GRANULARITY_NS), curr->schedule.vruntime)) {
+            smp_kick(cpu);
+        }
+    }
+}
+
+void dequeue(struct Process* process) {
+
+    struct FairQueue* queue = &queues[process->cpu];
+
+    if (!process->schedule.counted) {
+        return;
+    }
+
+    if (process == smp_cpus[process->cpu].curr) {
+        update_curr(process);
+    }
+
+    process->schedule.counted = 0;
+    queue->totalWeight -= process->schedule.weight;
+    queue->running--;
+
+    if (process->schedule.inTree) {
+        tree_erase(queue, process);
+    }
+}
+
+void put_prev(struct Process* process) {
+
+    // Blocked processes were already taken out of the load
+    if (!process->schedule.counted || process->schedule.inTree) {
+        return;
+    }
+
+    update_curr(process);
+    tree_insert(&queues[process->cpu], process);
+}
+
+/**
+ * Run the process that got the least CPU time for its weight.
+ */
+struct Process* pick_next(struct Cpu* cpu) {
+
+    struct FairQueue* queue = &queues[cpu->index];
+    struct Process* next = queue->leftmost;
+
+    if (next == NULL) {
+        return NULL;
+    }
+
+    tree_erase(queue, next);
+    next->schedule.execStart = next->schedule.picked = rdtsc();
+    update_min(queue, next);
+
+    return next;
+}
+
+/**
+ * Preempt the current process once it used up its share of the latency period.
+ */
+void tick(struct Process* process) {
+
+    struct FairQueue* queue = &queues[process->cpu];
+
+    if (!process->schedule.counted) {
+        return;
+    }
+
+    update_curr(process);
+    update_min(queue, process);
+
+    if (queue->leftmost != NULL && rdtsc() - process->schedule.picked > slice(queue, process)) {
+        smp_cpus[process->cpu].needResched = 1;
+    }
+}
+
+/**
+ * Send the running process behind everyone else, for this round.
+ */
+void yield(struct Process* process) {
+
+    struct FairQueue* queue = &queues[process->cpu];
+
+    if (!process->schedule.counted) {
+        return;
+    }
+
+    update_curr(process);
+
+    if (queue->leftmost != NULL &&
+            !before(queue->leftmost->schedule.vruntime, process->schedule.vruntime)) {
+        process->schedule.vruntime = queue->leftmost->schedule.vruntime + 1;
+    }
+}
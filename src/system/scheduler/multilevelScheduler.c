@@ -0,0 +1,131 @@
+#include "system/scheduler/class.h"
+#include "system/scheduler/readyList.h"
+#include "type.h"
+
+// Level 0 is the most urgent. Priorities are split in bands that map to
+// the odd levels, so a starving process can age past every fresh one.
+#define LEVELS 8
+#define PRIORITY_BANDS 4
+
+// How many decisions a process waits at the head of a level before it's bumped up
+#define AGING_ROUNDS 16
+
+// Each CPU has its own set of levels, processes are in those of process->cpu
+struct Levels {
+    struct ReadyList lists[LEVELS];
+    // Bit n is set when lists[n] is not empty
+    unsigned int nonEmpty;
+    size_t rounds;
+};
+
+static struct Levels levels[SMP_MAX_CPUS];
+
+static void enqueue(struct Process* process);
+
+static void dequeue(struct Process* process);
+
+static void put_prev(struct Process* process);
+
+static struct Process* pick_next(struct Cpu* cpu);
+
+static unsigned int base_level(struct Process* process);
+
+static void ready_push(struct Process* process, unsigned int level);
+
+static void ready_unlink(struct Process* process);
+
+static void age(struct Levels* own);
+
+// The lowest level with a ready process runs, and processes age up while they wait
+const struct SchedulerClass multilevel_class = {
+    "multilevel", enqueue, dequeue, put_prev, pick_next, NULL, NULL
+};
+
+unsigned int base_level(struct Process* process) {
+    unsigned int band = process->schedule.priority * PRIORITY_BANDS / PRIORITY_LEVELS;
+    return (PRIORITY_BANDS - 1 - band) * 2 + 1;
+}
+
+void ready_push(struct Process* process, unsigned int level) {
+
+    struct Levels* own = &levels[process->cpu];
+
+    process->schedule.level = level;
+    process->schedule.enqueued = own->rounds;
+    ready_list_push(&own->lists[level], process);
+
+    own->nonEmpty |= 1u << level;
+}
+
+void ready_unlink(struct Process* process) {
+
+    struct Levels* own = &levels[process->cpu];
+    struct ReadyList* list = &own->lists[process->schedule.level];
+
+    ready_list_remove(list, process);
+
+    if (list->first == NULL) {
+        own->nonEmpty &= ~(1u << process->schedule.level);
+    }
+}
+
+/**
+ * Move up the head of every level that waited for too long.
+ *
+ * Lists are FIFO, so the head is the one that waited the most. That keeps
+ * this bounded by the number of levels.
+ */
+void age(struct Levels* own) {
+
+    for (unsigned int level = 1; level < LEVELS; level++) {
+
+        struct Process* head = own->lists[level].first;
+        if (head != NULL && own->rounds - head->schedule.enqueued >= AGING_ROUNDS) {
+            ready_unlink(head);
+            ready_push(head, level - 1);
+        }
+    }
+}
+
+void enqueue(struct Process* process) {
+
+    // The running process is requeued when it's switched out
+    if (process->schedule.queued || process == smp_cpus[process->cpu].curr) {
+        return;
+    }
+
+    ready_push(process, base_level(process));
+}
+
+void dequeue(struct Process* process) {
+
+    if (process->schedule.queued) {
+        ready_unlink(process);
+    }
+}
+
+void put_prev(struct Process* process) {
+
+    // Whatever it got from aging is spent now
+    if (process->schedule.status == StatusReady && !process->schedule.queued) {
+        ready_push(process, base_level(process));
+    }
+}
+
+struct Process* pick_next(struct Cpu* cpu) {
+
+    struct Levels* own = &levels[cpu->index];
+
+    own->rounds++;
+    age(own);
+
+    if (own->nonEmpty == 0) {
+        return NULL;
+    }
+
+    // Compiles down to a bsf
+    struct Process* process = own->lists[__builtin_ctz(own->nonEmpty)].first;
+    ready_unlink(process);
+
+    return process;
+}
@@ -1,44 +1,76 @@
-#include "system/scheduler/choose_next.h"
-#include "system/scheduler.h"
-#include "system/processQueue.h"
+#include "system/scheduler/class.h"
+#include "system/scheduler/readyList.h"
 #include "type.h"
 
-static struct QueueNode* top_priority = NULL;
+static struct ReadyList ready[SMP_MAX_CPUS];
 
-static void updateAcumPriorities(void);
+static void enqueue(struct Process* process);
 
-void choose_next(void) {
+static void dequeue(struct Process* process);
 
-    if (scheduler_curr != NULL && scheduler_curr->schedule.status == StatusRunning) {
-        scheduler_curr->schedule.status = StatusReady;
-    }
+static void put_prev(struct Process* process);
 
-    updateAcumPriorities();
-    if (top_priority != NULL) {
-        scheduler_curr = top_priority->process;
-        top_priority->acumPriority = 1;
+static struct Process* pick_next(struct Cpu* cpu);
+
+static struct Process* updateAcumPriorities(struct ReadyList* list);
+
+// Every process accumulates its priority each round, and the one with the most runs
+const struct SchedulerClass priority_class = {
+    "priority", enqueue, dequeue, put_prev, pick_next, NULL, NULL
+};
+
+struct Process* updateAcumPriorities(struct ReadyList* list) {
+
+    struct Process* process = list->first;
+    struct Process* top_priority = list->first;
 
-        scheduler_curr->schedule.status = StatusRunning;
+    while (process != NULL) {
+
+        process->schedule.acumPriority += (process->schedule.priority + 1);
+        if (process->schedule.acumPriority > top_priority->schedule.acumPriority) {
+            top_priority = process;
+        }
+
+        process = process->schedule.readyNext;
     }
+
+    return top_priority;
 }
 
-void updateAcumPriorities(void) {
+void enqueue(struct Process* process) {
+
+    process->schedule.acumPriority = 1;
 
-    struct QueueNode* node = scheduler_queue.first;
-    top_priority = scheduler_queue.first;
+    // The running process is requeued when it's switched out
+    if (process->schedule.queued || process == smp_cpus[process->cpu].curr) {
+        return;
+    }
 
-    while (node != NULL) {
+    ready_list_push(&ready[process->cpu], process);
+}
 
-        if (node->process->schedule.status != StatusBlocked) {
+void dequeue(struct Process* process) {
 
-            node->acumPriority += (node->process->schedule.priority + 1);
-            if (node->acumPriority > top_priority->acumPriority) {
-                top_priority = node;
-            }
-        }
+    if (process->schedule.queued) {
+        ready_list_remove(&ready[process->cpu], process);
+    }
+}
+
+void put_prev(struct Process* process) {
 
-        node = node->next;
+    if (process->schedule.status == StatusReady && !process->schedule.queued) {
+        ready_list_push(&ready[process->cpu], process);
     }
 }
 
+struct Process* pick_next(struct Cpu* cpu) {
 
+    struct Process* top_priority = updateAcumPriorities(&ready[cpu->index]);
+
+    if (top_priority != NULL) {
+        ready_list_remove(&ready[cpu->index], top_priority);
+        top_priority->schedule.acumPriority = 1;
+    }
+
+    return top_priority;
+}
@@ -0,0 +1,34 @@
+#include "system/scheduler/readyList.h"
+#include "type.h"
+
+void ready_list_push(struct ReadyList* list, struct Process* process) {
+
+    process->schedule.queued = 1;
+    process->schedule.readyNext = NULL;
+    process->schedule.readyPrev = list->last;
+
+    if (list->last) {
+        list->last->schedule.readyNext = process;
+    } else {
+        list->first = process;
+    }
+    list->last = process;
+}
+
+void ready_list_remove(struct ReadyList* list, struct Process* process) {
+
+    if (process->schedule.readyPrev) {
+        process->schedule.readyPrev->schedule.readyNext = process->schedule.readyNext;
+    } else {
+        list->first = process->schedule.readyNext;
+    }
+
+    if (process->schedule.readyNext) {
+        process->schedule.readyNext->schedule.readyPrev = process->schedule.readyPrev;
+    } else {
+        list->last = process->schedule.readyPrev;
+    }
+
+    process->schedule.readyPrev = process->schedule.readyNext = NULL;
+    process->schedule.queued = 0;
+}
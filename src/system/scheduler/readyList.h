@@ -0,0 +1,20 @@
+#ifndef __SYSTEM_SCHEDULER_READYLIST__
+#define __SYSTEM_SCHEDULER_READYLIST__
+
+#include "system/process/process.h"
+
+/**
+ * A FIFO of ready processes, linked through schedule.readyPrev and readyNext.
+ *
+ * A process is in at most one, schedule.queued tells whether it is.
+ */
+struct ReadyList {
+    struct Process* first;
+    struct Process* last;
+};
+
+void ready_list_push(struct ReadyList* list, struct Process* process);
+
+void ready_list_remove(struct ReadyList* list, struct Process* process);
+
+#endif
@@ -0,0 +1,53 @@
+#include "system/scheduler/class.h"
+#include "system/scheduler/readyList.h"
+#include "type.h"
+
+static struct ReadyList ready[SMP_MAX_CPUS];
+
+static void enqueue(struct Process* process);
+
+static void dequeue(struct Process* process);
+
+static void put_prev(struct Process* process);
+
+static struct Process* pick_next(struct Cpu* cpu);
+
+// Everything that's ready takes turns, in the order it became ready
+const struct SchedulerClass round_robin_class = {
+    "roundrobin", enqueue, dequeue, put_prev, pick_next, NULL, NULL
+};
+
+void enqueue(struct Process* process) {
+
+    // The running process is requeued when it's switched out
+    if (process->schedule.queued || process == smp_cpus[process->cpu].curr) {
+        return;
+    }
+
+    ready_list_push(&ready[process->cpu], process);
+}
+
+void dequeue(struct Process* process) {
+
+    if (process->schedule.queued) {
+        ready_list_remove(&ready[process->cpu], process);
+    }
+}
+
+void put_prev(struct Process* process) {
+
+    if (process->schedule.status == StatusReady && !process->schedule.queued) {
+        ready_list_push(&ready[process->cpu], process);
+    }
+}
+
+struct Process* pick_next(struct Cpu* cpu) {
+
+    struct Process* process = ready[cpu->index].first;
+
+    if (process != NULL) {
+        ready_list_remove(&ready[cpu->index], process);
+    }
+
+    return process;
+}
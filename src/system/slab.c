@@ -0,0 +1,229 @@
+#include "system/slab.h"
+#include "system/mm.h"
+
+// Every slab is a single page, with its header at the start of it.
+// That way, the header for any object can be found by rounding its address down.
+#define SLAB_HEADER_SIZE 32u
+
+struct Slab {
+    struct SlabCache* cache;
+    struct Slab* prev;
+    struct Slab* next;
+    void* freeList;
+    size_t inUse;
+    size_t pages;
+};
+
+struct SlabCache {
+    struct Slab* partial;
+    struct Slab* empty;
+    struct SlabCacheStats stats;
+};
+
+static struct SlabCache caches[SLAB_CACHES];
+
+static int initialized = 0;
+
+static void init_caches(void);
+
+static size_t cache_index(size_t size);
+
+static struct Slab* slab_of(void* ptr);
+
+static struct Slab* new_slab(struct SlabCache* cache);
+
+static void unlink_slab(struct SlabCache* cache, struct Slab* slab);
+
+static void link_slab(struct SlabCache* cache, struct Slab* slab);
+
+void init_caches(void) {
+
+    for (size_t i = 0; i < SLAB_CACHES; i++) {
+        caches[i].partial = NULL;
+        caches[i].empty = NULL;
+
+        caches[i].stats.objectSize = SLAB_MIN_SIZE << i;
+        caches[i].stats.objectsPerSlab = (PAGE_SIZE - SLAB_HEADER_SIZE) / caches[i].stats.objectSize;
+        caches[i].stats.slabs = 0;
+        caches[i].stats.active = 0;
+        caches[i].stats.allocs = 0;
+        caches[i].stats.frees = 0;
+    }
+
+    initialized = 1;
+}
+
+size_t cache_index(size_t size) {
+
+    if (size <= SLAB_MIN_SIZE) {
+        return 0;
+    }
+
+    // Round up to the next power of two, and take it's distance to the smallest class
+    return (32 - __builtin_clz(size - 1)) - SLAB_MIN_SHIFT;
+}
+
+struct Slab* slab_of(void* ptr) {
+    return (struct Slab*) (((size_t) ptr) & ~(PAGE_SIZE - 1));
+}
+
+struct Slab* new_slab(struct SlabCache* cache) {
+
+    struct Slab* slab = allocPage();
+    if (slab == NULL) {
+        return NULL;
+    }
+
+    slab->cache = cache;
+    slab->prev = slab->next = NULL;
+    slab->inUse = 0;
+    slab->pages = 1;
+
+    // Thread the free list through the objects themselves
+    char* object = (char*) slab + SLAB_HEADER_SIZE;
+    slab->freeList = object;
+    for (size_t i = 1; i < cache->stats.objectsPerSlab; i++) {
+        *(void**) object = object + cache->stats.objectSize;
+        object += cache->stats.objectSize;
+    }
+    *(void**) object = NULL;
+
+    cache->stats.slabs++;
+
+    return slab;
+}
+
+void link_slab(struct SlabCache* cache, struct Slab* slab) {
+
+    slab->prev = NULL;
+    slab->next = cache->partial;
+    if (cache->partial) {
+        cache->partial->prev = slab;
+    }
+    cache->partial = slab;
+}
+
+void unlink_slab(struct SlabCache* cache, struct Slab* slab) {
+
+    if (slab->prev) {
+        slab->prev->next = slab->next;
+    } else {
+        cache->partial = slab->next;
+    }
+
+    if (slab->next) {
+        slab->next->prev = slab->prev;
+    }
+
+    slab->prev = slab->next = NULL;
+}
+
+void* kmalloc(size_t size) {
+
+    if (size == 0) {
+        return NULL;
+    }
+
+    if (!initialized) {
+        init_caches();
+    }
+
+    if (size > SLAB_MAX_SIZE) {
+
+        size_t pages = (size + SLAB_HEADER_SIZE + PAGE_SIZE - 1) / PAGE_SIZE;
+        struct Slab* slab = allocPages(pages);
+        if (slab == NULL) {
+            return NULL;
+        }
+
+        slab->cache = NULL;
+        slab->pages = pages;
+
+        return (char*) slab + SLAB_HEADER_SIZE;
+    }
+
+    struct SlabCache* cache = &caches[cache_index(size)];
+    struct Slab* slab = cache->partial;
+
+    if (slab == NULL) {
+
+        if (cache->empty) {
+            slab = cache->empty;
+            cache->empty = NULL;
+        } else {
+            slab = new_slab(cache);
+            if (slab == NULL) {
+                return NULL;
+            }
+        }
+
+        link_slab(cache, slab);
+    }
+
+    void* object = slab->freeList;
+    slab->freeList = *(void**) object;
+    slab->inUse++;
+
+    if (slab->freeList == NULL) {
+        // Full slabs are kept out of every list, kfree will find them anyway
+        unlink_slab(cache, slab);
+    }
+
+    cache->stats.active++;
+    cache->stats.allocs++;
+
+    return object;
+}
+
+void kfree(void* ptr) {
+
+    if (ptr == NULL) {
+        return;
+    }
+
+    struct Slab* slab = slab_of(ptr);
+    struct SlabCache* cache = slab->cache;
+
+    if (cache == NULL) {
+        freePages(slab, slab->pages);
+        return;
+    }
+
+    if (slab->freeList == NULL) {
+        link_slab(cache, slab);
+    }
+
+    *(void**) ptr = slab->freeList;
+    slab->freeList = ptr;
+    slab->inUse--;
+
+    cache->stats.active--;
+    cache->stats.frees++;
+
+    if (slab->inUse == 0) {
+
+        unlink_slab(cache, slab);
+
+        // Keep one empty slab around, so a cache doesn't bounce pages on alloc/free pairs
+        if (cache->empty == NULL) {
+            cache->empty = slab;
+        } else {
+            cache->stats.slabs--;
+            freePages(slab, 1);
+        }
+    }
+}
+
+int kmalloc_cache_stats(size_t cache, struct SlabCacheStats* stats) {
+
+    if (cache >= SLAB_CACHES) {
+        return -1;
+    }
+
+    if (!initialized) {
+        init_caches();
+    }
+
+    *stats = caches[cache].stats;
+    return 0;
+}
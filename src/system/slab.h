@@ -0,0 +1,25 @@
+#ifndef __SYSTEM_SLAB__
+#define __SYSTEM_SLAB__
+
+#include "type.h"
+
+#define SLAB_MIN_SHIFT 4
+#define SLAB_MAX_SHIFT 11
+
+#define SLAB_MIN_SIZE (1u << SLAB_MIN_SHIFT)
+#define SLAB_MAX_SIZE (1u << SLAB_MAX_SHIFT)
+
+#define SLAB_CACHES (SLAB_MAX_SHIFT - SLAB_MIN_SHIFT + 1)
+
+/**
+ * Alloc size bytes from the size-class cache that fits it.
+ *
+ * Requests bigger than SLAB_MAX_SIZE are served straight from allocPages.
+ */
+void* kmalloc(size_t size);
+
+void kfree(void* ptr);
+
+int kmalloc_cache_stats(size_t cache, struct SlabCacheStats* stats);
+
+#endif
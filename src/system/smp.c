@@ -0,0 +1,551 @@
+#include "system/smp.h"
+#include "system/apic.h"
+#include "system/cpu.h"
+#include "system/fpu.h"
+#include "system/pmu.h"
+#include "system/gdt.h"
+#include "system/mm.h"
+#include "system/paging.h"
+#include "system/timer.h"
+#include "system/call.h"
+#include "system/common.h"
+#include "system/interrupt.h"
+#include "system/sync.h"
+#include "system/process/table.h"
+#include "library/string.h"
+
+#define EBDA_SEGMENT 0x40E
+#define BIOS_ROM_START 0xE0000
+#define BIOS_ROM_END 0x100000
+#define BASE_MEMORY_END 0xA0000
+
+#define MADT_LOCAL_APIC 0
+#define MADT_ENABLED 0x1
+
+#define MP_PROCESSOR 0
+#define MP_PROCESSOR_SIZE 20
+#define MP_OTHER_SIZE 8
+#define MP_ENABLED 0x1
+
+// Startup IPIs carry the page the AP starts at
+#define STARTUP_VECTOR (TRAMPOLINE_BASE >> 12)
+
+#define INIT_DELAY_US 10000
+#define STARTUP_DELAY_US 200
+#define ONLINE_TIMEOUT_US 100000
+
+#define AP_STACK_SIZE PAGE_SIZE
+
+#pragma pack(1)
+
+struct RootPointer {
+    char signature[8];
+    unsigned char checksum;
+    char oem[6];
+    unsigned char revision;
+    unsigned int rsdt;
+};
+
+struct TableHeader {
+    char signature[4];
+    unsigned int length;
+    unsigned char revision;
+    unsigned char checksum;
+    char oem[6];
+    char oemTable[8];
+    unsigned int oemRevision;
+    unsigned int creator;
+    unsigned int creatorRevision;
+};
+
+struct Madt {
+    struct TableHeader header;
+    unsigned int lapicAddress;
+    unsigned int flags;
+};
+
+struct MadtLocalApic {
+    unsigned char type;
+    unsigned char length;
+    unsigned char acpiId;
+    unsigned char apicId;
+    unsigned int flags;
+};
+
+struct MpFloatingPointer {
+    char signature[4];
+    unsigned int config;
+    unsigned char length;
+    unsigned char revision;
+    unsigned char checksum;
+    unsigned char features[5];
+};
+
+struct MpConfig {
+    char signature[4];
+    unsigned short length;
+    unsigned char revision;
+    unsigned char checksum;
+    char oem[20];
+    unsigned int oemTable;
+    unsigned short oemTableSize;
+    unsigned short entries;
+    unsigned int lapicAddress;
+    unsigned short extendedLength;
+    unsigned char extendedChecksum;
+    unsigned char reserved;
+};
+
+struct MpProcessor {
+    unsigned char type;
+    unsigned char apicId;
+    unsigned char version;
+    unsigned char flags;
+    unsigned int signature;
+    unsigned int features;
+    unsigned int reserved[2];
+};
+
+#pragma pack()
+
+// What the trampoline picks up, laid out as _trampolineData
+struct TrampolineData {
+    unsigned int cr3;
+    unsigned int cr4;
+    void (*entry)(void);
+    const volatile unsigned int* lapicId;
+    // One per CPU, in smp_cpus order, so each one finds its own
+    struct {
+        unsigned int apicId;
+        void* stack;
+    } slot[SMP_MAX_CPUS];
+};
+
+struct Cpu smp_cpus[SMP_MAX_CPUS] = {
+    [0] = { .self = &smp_cpus[0], .index = 0, .online = 1 }
+};
+
+unsigned int smp_cpu_count = 1;
+
+// The kernel lock, and the CPU that holds it
+static struct Spinlock kernelLock = SPINLOCK_INIT;
+
+static volatile int lockOwner = -1;
+
+static void (*idleEntry)(char*) = NULL;
+
+extern char _trampolineStart[];
+extern char _trampolineEnd[];
+extern char _trampolineData[];
+
+static int checksum(const void* data, size_t length);
+
+static unsigned int ebda_address(void);
+
+static const void* map_physical(unsigned int address, size_t length);
+
+static const void* scan(unsigned int start, unsigned int end, const char* signature, size_t length);
+
+static void add_cpu(unsigned int apicId);
+
+static int parse_madt(void);
+
+static int parse_mp(void);
+
+static void delay(unsigned int us);
+
+static int boot(struct Cpu* cpu);
+
+static struct TrampolineData* trampoline_data(void);
+
+static void ap_entry(void);
+
+int checksum(const void* data, size_t length) {
+
+    const unsigned char* bytes = data;
+    unsigned char sum = 0;
+
+    for (size_t i = 0; i < length; i++) {
+        sum += bytes[i];
+    }
+
+    return sum == 0;
+}
+
+/**
+ * Where the extended BIOS data area starts, as the BIOS data area says.
+ */
+unsigned int ebda_address(void) {
+
+    unsigned short segment;
+    memcpy(&segment, (const void*) EBDA_SEGMENT, sizeof(segment));
+
+    return segment << 4;
+}
+
+/**
+ * Make sure firmware tables can be read where they are.
+ *
+ * Memory is identity mapped, but only as far as the allocator manages it,
+ * and firmware likes to put tables right after that.
+ */
+const void* map_physical(unsigned int address, size_t length) {
+
+    unsigned int page = address & ~(PAGE_SIZE - 1);
+    for (; page < address + length; page += PAGE_SIZE) {
+        if (paging_lookup(paging_kernel_space(), (void*) page) == NULL &&
+                paging_map(paging_kernel_space(), (void*) page, (void*) page, 0) != 0) {
+            return NULL;
+        }
+    }
+
+    return (const void*) address;
+}
+
+/**
+ * Look for a structure on 16 byte boundaries, as firmware leaves them.
+ */
+const void* scan(unsigned int start, unsigned int end, const char* signature, size_t length) {
+
+    for (unsigned int address = start; address + length <= end; address += 16) {
+        if (memcmp((const void*) address, signature, strlen(signature)) == 0 &&
+                checksum((const void*) address, length)) {
+            return (const void*) address;
+        }
+    }
+
+    return NULL;
+}
+
+void add_cpu(unsigned int apicId) {
+
+    // The boot CPU is already there
+    if (apicId == smp_cpus[0].apicId || smp_cpu_count == SMP_MAX_CPUS) {
+        return;
+    }
+
+    struct Cpu* cpu = &smp_cpus[smp_cpu_count];
+    cpu->self = cpu;
+    cpu->index = smp_cpu_count;
+    cpu->apicId = apicId;
+    cpu->online = 0;
+
+    smp_cpu_count++;
+}
+
+/**
+ * Find the CPUs in the ACPI MADT.
+ *
+ * @return 0 if the table was there, -1 otherwise.
+ */
+int parse_madt(void) {
+
+    unsigned int ebda = ebda_address();
+
+    const struct RootPointer* root = NULL;
+    if (ebda) {
+        root = scan(ebda, ebda + 1024, "RSD PTR ", sizeof(struct RootPointer));
+    }
+    if (root == NULL) {
+        root = scan(BIOS_ROM_START, BIOS_ROM_END, "RSD PTR ", sizeof(struct RootPointer));
+    }
+    if (root == NULL) {
+        return -1;
+    }
+
+    const struct TableHeader* rsdt = map_physical(root->rsdt, sizeof(struct TableHeader));
+    if (rsdt == NULL || map_physical(root->rsdt, rsdt->length) == NULL) {
+        return -1;
+    }
+
+    const unsigned int* tables = (const unsigned int*) (rsdt + 1);
+    size_t count = (rsdt->length - sizeof(struct TableHeader)) / sizeof(unsigned int);
+
+    for (size_t i = 0; i < count; i++) {
+
+        const struct TableHeader* table = map_physical(tables[i], sizeof(struct TableHeader));
+        if (table == NULL || memcmp(table->signature, "APIC", 4) != 0) {
+            continue;
+        }
+
+        if (map_physical(tables[i], table->length) == NULL || !checksum(table, table->length)) {
+            return -1;
+        }
+
+        const unsigned char* entry = (const unsigned char*) table + sizeof(struct Madt);
+        const unsigned char* end = (const unsigned char*) table + table->length;
+
+        while (entry + 2 <= end && entry[1] >= 2) {
+
+            const struct MadtLocalApic* lapic = (const struct MadtLocalApic*) entry;
+            if (lapic->type == MADT_LOCAL_APIC && (lapic->flags & MADT_ENABLED)) {
+                add_cpu(lapic->apicId);
+            }
+
+            entry += lapic->length;
+        }
+
+        return 0;
+    }
+
+    return -1;
+}
+
+/**
+ * Find the CPUs in the MP configuration table, for machines without ACPI.
+ *
+ * @return 0 if the table was there, -1 otherwise.
+ */
+int parse_mp(void) {
+
+    unsigned int ebda = ebda_address();
+
+    const struct MpFloatingPointer* pointer = NULL;
+    if (ebda) {
+        pointer = scan(ebda, ebda + 1024, "_MP_", sizeof(struct MpFloatingPointer));
+    }
+    if (pointer == NULL) {
+        pointer = scan(BASE_MEMORY_END - 1024, BASE_MEMORY_END, "_MP_", sizeof(struct MpFloatingPointer));
+    }
+    if (pointer == NULL) {
+        pointer = scan(BIOS_ROM_START, BIOS_ROM_END, "_MP_", sizeof(struct MpFloatingPointer));
+    }
+    if (pointer == NULL || pointer->config == 0) {
+        return -1;
+    }
+
+    const struct MpConfig* config = map_physical(pointer->config, sizeof(struct MpConfig));
+    if (config == NULL || memcmp(config->signature, "PCMP", 4) != 0 ||
+            map_physical(pointer->config, config->length) == NULL) {
+        return -1;
+    }
+
+    const unsigned char* entry = (const unsigned char*) (config + 1);
+    for (unsigned int i = 0; i < config->entries; i++) {
+
+        if (*entry != MP_PROCESSOR) {
+            entry += MP_OTHER_SIZE;
+            continue;
+        }
+
+        const struct MpProcessor* processor = (const struct MpProcessor*) entry;
+        if (processor->flags & MP_ENABLED) {
+            add_cpu(processor->apicId);
+        }
+
+        entry += MP_PROCESSOR_SIZE;
+    }
+
+    return 0;
+}
+
+void delay(unsigned int us) {
+
+    unsigned long long hz = timer_cycles_per_second();
+    if (hz == 0) {
+        // No TSC, so no way to tell. This is long enough on anything that has an APIC.
+        for (volatile unsigned int i = 0; i < us * 1000; i++);
+        return;
+    }
+
+    unsigned long long end = rdtsc() + hz / 1000000 * us;
+    while (rdtsc() < end) {
+        __asm__ __volatile__ ("pause");
+    }
+}
+
+struct TrampolineData* trampoline_data(void) {
+    return (struct TrampolineData*) (TRAMPOLINE_BASE + (_trampolineData - _trampolineStart));
+}
+
+/**
+ * Wake up an application processor with INIT, startup, startup.
+ *
+ * @return 0 if it came online, -1 otherwise.
+ */
+int boot(struct Cpu* cpu) {
+
+    void* stack = allocPage();
+    if (stack == NULL) {
+        return -1;
+    }
+
+    trampoline_data()->slot[cpu->index].stack = (char*) stack + AP_STACK_SIZE;
+
+    lapic_send_ipi(cpu->apicId, LAPIC_IPI_INIT);
+    delay(INIT_DELAY_US);
+
+    for (int i = 0; i < 2 && !cpu->online; i++) {
+        lapic_send_ipi(cpu->apicId, LAPIC_IPI_STARTUP | STARTUP_VECTOR);
+        delay(STARTUP_DELAY_US);
+    }
+
+    for (unsigned int waited = 0; !cpu->online && waited < ONLINE_TIMEOUT_US; waited += STARTUP_DELAY_US) {
+        delay(STARTUP_DELAY_US);
+    }
+
+    if (!cpu->online) {
+        // Its slot and stack are left alone, in case it shows up late
+        return -1;
+    }
+
+    return 0;
+}
+
+/**
+ * C entry point of the application processors, called by the trampoline.
+ *
+ * The boot CPU already set up everything that's shared, so this only
+ * sets up what each CPU has for itself. Then it creates its idle process
+ * and waits for the first tick to start scheduling, like kmain does.
+ */
+void ap_entry(void) {
+
+    // The trampoline only lets in CPUs that were given a stack, so it's there.
+    // The local APIC is already mapped, the boot CPU did it.
+    struct Cpu* cpu = &smp_cpus[1];
+    while (cpu->apicId != lapic_id()) {
+        cpu++;
+    }
+
+    setupGDT(cpu);
+    loadIDT();
+
+    fpu_init();
+    pmu_init();
+    syscall_init();
+    paging_init_cpu();
+    lapic_init();
+    timer_init_cpu();
+
+    smp_lock_kernel();
+    process_table_new(idleEntry, NULL, NULL, 1, NO_TERMINAL, 0);
+    smp_unlock_kernel();
+
+    cpu->online = 1;
+
+    enableInterrupts();
+    while (1) {}
+}
+
+/**
+ * Find the other CPUs and start them.
+ *
+ * The ACPI MADT is used when there is one, the MP table otherwise.
+ * Without a local APIC there's no way to talk to them, so it's just the boot CPU.
+ *
+ * @param idle The code of the idle process each CPU gets.
+ */
+void smp_init(void (*idle)(char*)) {
+
+    lock_stats_register("kernel", &kernelLock.stats);
+
+    if (!lapic_present()) {
+        return;
+    }
+
+    smp_cpus[0].apicId = lapic_id();
+
+    if (parse_madt() != 0) {
+        parse_mp();
+    }
+
+    if (smp_cpu_count == 1) {
+        return;
+    }
+
+    idleEntry = idle;
+    memcpy((void*) TRAMPOLINE_BASE, _trampolineStart, _trampolineEnd - _trampolineStart);
+
+    unsigned int cr4;
+    __asm__ __volatile__ ("mov %%cr4, %0":"=r"(cr4));
+
+    struct TrampolineData* data = trampoline_data();
+    data->cr3 = (unsigned int) paging_kernel_space()->directory;
+    data->cr4 = cr4;
+    data->entry = ap_entry;
+    data->lapicId = lapic_register(LAPIC_ID);
+
+    // Stacks are only handed out as each one is started
+    for (unsigned int i = 0; i < smp_cpu_count; i++) {
+        data->slot[i].apicId = smp_cpus[i].apicId;
+        data->slot[i].stack = NULL;
+    }
+
+    // The ones that don't start in time stay in the table, and only get work if they show up later
+    for (unsigned int i = 1; i < smp_cpu_count; i++) {
+        boot(&smp_cpus[i]);
+    }
+}
+
+/**
+ * Take the kernel lock.
+ *
+ * Every way into the kernel takes it: interrupts, system calls and page
+ * faults. A CPU that holds it can take it again, a page fault in the
+ * middle of a system call does.
+ *
+ * It's held across context switches, the process switched to releases it
+ * on its way out.
+ */
+void smp_lock_kernel(void) {
+
+    struct Cpu* cpu = smp_cpu();
+
+    if (lockOwner == (int) cpu->index) {
+        cpu->lockDepth++;
+        return;
+    }
+
+    spin_lock(&kernelLock);
+
+    lockOwner = cpu->index;
+    cpu->lockDepth = 1;
+
+    // Mappings might have gone away while we weren't looking
+    paging_sync();
+}
+
+void smp_unlock_kernel(void) {
+
+    struct Cpu* cpu = smp_cpu();
+
+    if (--cpu->lockDepth > 0) {
+        return;
+    }
+
+    lockOwner = -1;
+    spin_unlock(&kernelLock);
+}
+
+/**
+ * Take the kernel lock from a kernel process, which runs with interrupts enabled.
+ *
+ * Interrupts stay disabled until smp_leave_kernel, an interrupt handler
+ * taking the lock again would switch processes with it held twice.
+ */
+void smp_enter_kernel(void) {
+    disableInterrupts();
+    smp_lock_kernel();
+}
+
+void smp_leave_kernel(void) {
+    smp_unlock_kernel();
+    enableInterrupts();
+}
+
+/**
+ * Make a CPU go through the scheduler as soon as possible.
+ *
+ * If it's another CPU, it gets an interrupt so it doesn't wait for its next tick.
+ *
+ * @param cpu The CPU.
+ */
+void smp_kick(struct Cpu* cpu) {
+
+    cpu->needResched = 1;
+
+    if (cpu != smp_cpu() && cpu->online) {
+        lapic_send_ipi(cpu->apicId, LAPIC_IPI_FIXED | RESCHED_VECTOR);
+    }
+}
@@ -0,0 +1,84 @@
+#ifndef __SYSTEM_SMP__
+#define __SYSTEM_SMP__
+
+#include "system/processQueue.h"
+#include "system/profile.h"
+#include "type.h"
+
+#define SMP_MAX_CPUS 8
+
+// Where the application processors start, must match trampoline.asm
+#define TRAMPOLINE_BASE 0x8000
+
+#define RESCHED_VECTOR 0x31
+
+struct Process;
+
+struct AddressSpace;
+
+/**
+ * Everything that exists once per CPU.
+ *
+ * Each CPU reaches its own through the segment in FS, see smp_cpu.
+ */
+struct Cpu {
+    // Must be first, it's what FS:0 points to
+    struct Cpu* self;
+    unsigned int index;
+    unsigned int apicId;
+    volatile int online;
+
+    // Scheduler state, only touched with the kernel lock held
+    struct Process* curr;
+    struct Process* idle;
+    struct ProcessQueue runQueue;
+    int needResched;
+    int yielded;
+    size_t quantumLeft;
+    unsigned long long cycles;
+
+    // Whose state is loaded in this CPU's FPU
+    struct Process* fpuOwner;
+
+    struct AddressSpace* space;
+    unsigned int tlbGeneration;
+
+    // Local APIC timer interrupts per tick, and where we are in the current one
+    unsigned int samplesPerTick;
+    unsigned int subTick;
+
+    // Where the profiler leaves the samples taken here
+    struct ProfileRing profile;
+
+    // Nesting of the kernel lock, page faults can take it again
+    unsigned int lockDepth;
+};
+
+extern struct Cpu smp_cpus[SMP_MAX_CPUS];
+
+extern unsigned int smp_cpu_count;
+
+/**
+ * The CPU running this code.
+ *
+ * It's volatile on purpose, a process that blocks may come back on another CPU.
+ */
+inline static struct Cpu* smp_cpu(void) {
+    struct Cpu* cpu;
+    __asm__ __volatile__ ("mov %%fs:0, %0":"=r"(cpu));
+    return cpu;
+}
+
+void smp_init(void (*idle)(char*));
+
+void smp_lock_kernel(void);
+
+void smp_unlock_kernel(void);
+
+void smp_enter_kernel(void);
+
+void smp_leave_kernel(void);
+
+void smp_kick(struct Cpu* cpu);
+
+#endif
@@ -0,0 +1,55 @@
+#include "system/symbols.h"
+#include "system/call.h"
+#include "library/stdlib.h"
+#include "library/string.h"
+
+/**
+ * Find the function an address belongs to.
+ *
+ * @param address An address in the kernel's code.
+ *
+ * @return The closest symbol at or below address, NULL if there's none.
+ */
+const struct KernelSymbolEntry* symbols_lookup(unsigned int address) {
+
+    size_t low = 0;
+    size_t high = kernelSymbolCount;
+
+    while (low < high) {
+        size_t mid = low + (high - low) / 2;
+        if (kernelSymbols[mid].address <= address) {
+            low = mid + 1;
+        } else {
+            high = mid;
+        }
+    }
+
+    return low ? &kernelSymbols[low - 1] : NULL;
+}
+
+/**
+ * System call that symbolizes a kernel address.
+ *
+ * @param address The address to look up.
+ * @param symbol Where to store the symbol it belongs to.
+ *
+ * @return 0 on success, -1 if it's below every symbol.
+ */
+int _ksymbol(unsigned int address, struct KernelSymbol* symbol) {
+
+    const struct KernelSymbolEntry* entry = symbols_lookup(address);
+    if (entry == NULL) {
+        return -1;
+    }
+
+    symbol->address = entry->address;
+    symbol->size = 0;
+    if (entry + 1 < kernelSymbols + kernelSymbolCount) {
+        symbol->size = entry[1].address - entry->address;
+    }
+
+    strncpy(symbol->name, entry->name, KSYMBOL_NAME_LEN - 1);
+    symbol->name[KSYMBOL_NAME_LEN - 1] = '\0';
+
+    return 0;
+}
@@ -0,0 +1,18 @@
+#ifndef __SYSTEM_SYMBOLS__
+#define __SYSTEM_SYMBOLS__
+
+#include "type.h"
+
+// Generated at link time by ksyms.awk, sorted by address
+struct KernelSymbolEntry {
+    unsigned int address;
+    const char* name;
+};
+
+extern const struct KernelSymbolEntry kernelSymbols[];
+
+extern const size_t kernelSymbolCount;
+
+const struct KernelSymbolEntry* symbols_lookup(unsigned int address);
+
+#endif
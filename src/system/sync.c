@@ -0,0 +1,379 @@
+#include "system/sync.h"
+#include "system/process/table.h"
+#include "system/scheduler.h"
+#include "system/common.h"
+#include "system/cpu.h"
+
+#define EFLAGS_IF 0x200
+
+// Keeps the compiler from moving memory accesses across lock boundaries.
+// x86 doesn't reorder them the way that would matter here.
+#define barrier() __asm__ __volatile__ ("":::"memory")
+
+struct RegisteredLock {
+    char name[LOCK_NAME_LEN];
+    struct LockStats* stats;
+};
+
+static struct RegisteredLock registered[LOCK_STATS_MAX];
+
+static size_t registeredCount = 0;
+
+void spin_init(struct Spinlock* lock) {
+    lock->next = lock->serving = 0;
+    lock->stats.acquired = 0;
+    lock->stats.contended = 0;
+    lock->stats.waitCycles = 0;
+}
+
+/**
+ * Take a ticket, and spin until it's served.
+ *
+ * This doesn't touch interrupts, so it's only safe from code that already
+ * runs with them disabled, see spin_lock_irqsave.
+ *
+ * @param lock The lock.
+ */
+void spin_lock(struct Spinlock* lock) {
+
+    unsigned short ticket = __sync_fetch_and_add(&lock->next, 1);
+
+    if (lock->serving != ticket) {
+
+        unsigned long long start = rdtsc();
+        while (lock->serving != ticket) {
+            __asm__ __volatile__ ("pause");
+        }
+
+        lock->stats.contended++;
+        lock->stats.waitCycles += rdtsc() - start;
+    }
+
+    barrier();
+    lock->stats.acquired++;
+}
+
+void spin_unlock(struct Spinlock* lock) {
+    barrier();
+    lock->serving++;
+}
+
+/**
+ * Disable interrupts on this CPU, and take the lock.
+ *
+ * That way an interrupt handler that takes the same lock can't deadlock
+ * against the code it interrupted.
+ *
+ * @param lock The lock.
+ *
+ * @return The flags to hand back to spin_unlock_irqrestore.
+ */
+unsigned int spin_lock_irqsave(struct Spinlock* lock) {
+
+    unsigned int flags = getFlags();
+
+    disableInterrupts();
+    spin_lock(lock);
+
+    return flags;
+}
+
+void spin_unlock_irqrestore(struct Spinlock* lock, unsigned int flags) {
+
+    spin_unlock(lock);
+
+    if (flags & EFLAGS_IF) {
+        enableInterrupts();
+    }
+}
+
+void wait_queue_init(struct WaitQueue* queue) {
+    queue->processes.first = queue->processes.last = NULL;
+    queue->processes.size = 0;
+    queue->owner = NULL;
+    queue->ownedNext = NULL;
+}
+
+/**
+ * Block the current process on a wait queue, until it's woken up.
+ *
+ * It can also be woken up by a timeout or a signal, so callers check
+ * their condition again in a loop. Must be called with the kernel lock held.
+ *
+ * Whoever owns the queue inherits its priority while it's there.
+ *
+ * @param queue The wait queue.
+ */
+void wait_queue_sleep(struct WaitQueue* queue) {
+
+    struct Process* self = scheduler_current();
+
+    process_table_wait_on(self, &queue->processes);
+    self->waitingOn = queue;
+
+    if (queue->owner != NULL) {
+        wait_queue_update_priority(queue->owner);
+    }
+
+    scheduler_do();
+
+    // Whoever owns it now doesn't have to hurry on its behalf anymore
+    self->waitingOn = NULL;
+    if (queue->owner != NULL) {
+        wait_queue_update_priority(queue->owner);
+    }
+}
+
+/**
+ * Wake up the most urgent process, the one that waited the longest among equals.
+ *
+ * @param queue The wait queue.
+ *
+ * @return 1 if a process was woken up, 0 if the queue was empty.
+ */
+int wait_queue_wake_one(struct WaitQueue* queue) {
+
+    struct Process* process = queue->processes.first;
+    if (process == NULL) {
+        return 0;
+    }
+
+    for (struct Process* waiter = process->queueNext; waiter != NULL; waiter = waiter->queueNext) {
+        if (waiter->schedule.priority > process->schedule.priority) {
+            process = waiter;
+        }
+    }
+
+    process_table_unblock(process);
+    return 1;
+}
+
+/**
+ * Wake up every process in a wait queue.
+ *
+ * @param queue The wait queue.
+ *
+ * @return The number of processes woken up.
+ */
+size_t wait_queue_wake_all(struct WaitQueue* queue) {
+
+    size_t woken = 0;
+    while (wait_queue_wake_one(queue)) {
+        woken++;
+    }
+
+    return woken;
+}
+
+/**
+ * Make a process responsible for what a wait queue's processes wait for.
+ *
+ * It inherits their priority, until it stops being the owner.
+ *
+ * @param queue The wait queue.
+ * @param owner The process, or NULL for none.
+ */
+void wait_queue_set_owner(struct WaitQueue* queue, struct Process* owner) {
+
+    struct Process* previous = queue->owner;
+    if (previous == owner) {
+        return;
+    }
+
+    if (previous != NULL) {
+
+        struct WaitQueue** link = &previous->owned;
+        while (*link != queue) {
+            link = &(*link)->ownedNext;
+        }
+
+        *link = queue->ownedNext;
+    }
+
+    queue->owner = owner;
+    queue->ownedNext = NULL;
+
+    if (owner != NULL) {
+        queue->ownedNext = owner->owned;
+        owner->owned = queue;
+    }
+
+    if (previous != NULL) {
+        wait_queue_update_priority(previous);
+    }
+
+    if (owner != NULL && queue->processes.first != NULL) {
+        wait_queue_update_priority(owner);
+    }
+}
+
+/**
+ * Work out the priority a process runs at.
+ *
+ * That's the one its nice value gives it, or the priority of the most
+ * urgent process waiting on a queue it owns, if that's higher. When it
+ * changes, so can the priority of the owner of the queue it waits on.
+ *
+ * @param process The process.
+ */
+void wait_queue_update_priority(struct Process* process) {
+
+    for (int depth = 0; process != NULL && depth < INHERIT_DEPTH; depth++) {
+
+        int priority = NICE_MAX - process->schedule.nice;
+
+        for (struct WaitQueue* queue = process->owned; queue != NULL; queue = queue->ownedNext) {
+            for (struct Process* waiter = queue->processes.first; waiter != NULL; waiter = waiter->queueNext) {
+                if (waiter->schedule.priority > priority) {
+                    priority = waiter->schedule.priority;
+                }
+            }
+        }
+
+        if (priority == process->schedule.priority) {
+            return;
+        }
+
+        scheduler_set_priority(process, priority);
+        process = process->waitingOn ? process->waitingOn->owner : NULL;
+    }
+}
+
+void mutex_init(struct Mutex* mutex) {
+    wait_queue_init(&mutex->waiters);
+    mutex->stats.acquired = 0;
+    mutex->stats.contended = 0;
+    mutex->stats.waitCycles = 0;
+}
+
+/**
+ * Take the mutex, sleeping until it's released if it's held.
+ *
+ * While the caller waits, the holder runs at its priority if that's
+ * higher. Only processes can sleep, so this can't be used from interrupt
+ * handlers.
+ *
+ * @param mutex The mutex.
+ */
+void mutex_lock(struct Mutex* mutex) {
+
+    if (mutex->waiters.owner != NULL) {
+
+        unsigned long long start = rdtsc();
+
+        // Whoever is woken up competes with anyone that comes in meanwhile
+        while (mutex->waiters.owner != NULL) {
+            wait_queue_sleep(&mutex->waiters);
+        }
+
+        mutex->stats.contended++;
+        mutex->stats.waitCycles += rdtsc() - start;
+    }
+
+    // It inherits from whoever is still waiting right away
+    wait_queue_set_owner(&mutex->waiters, scheduler_current());
+    mutex->stats.acquired++;
+}
+
+/**
+ * Release the mutex, waking up whoever is the most urgent to take it.
+ *
+ * The caller drops back to its own priority.
+ *
+ * @param mutex The mutex.
+ */
+void mutex_unlock(struct Mutex* mutex) {
+    wait_queue_set_owner(&mutex->waiters, NULL);
+    wait_queue_wake_one(&mutex->waiters);
+}
+
+void semaphore_init(struct Semaphore* semaphore, int count) {
+    semaphore->count = count;
+    wait_queue_init(&semaphore->waiters);
+    semaphore->stats.acquired = 0;
+    semaphore->stats.contended = 0;
+    semaphore->stats.waitCycles = 0;
+}
+
+/**
+ * Take a unit, sleeping until there's one if they're all taken.
+ *
+ * @param semaphore The semaphore.
+ */
+void semaphore_down(struct Semaphore* semaphore) {
+
+    if (semaphore->count <= 0) {
+
+        unsigned long long start = rdtsc();
+
+        while (semaphore->count <= 0) {
+            wait_queue_sleep(&semaphore->waiters);
+        }
+
+        semaphore->stats.contended++;
+        semaphore->stats.waitCycles += rdtsc() - start;
+    }
+
+    semaphore->count--;
+    semaphore->stats.acquired++;
+}
+
+/**
+ * Give a unit back, waking up whoever is the most urgent to take it.
+ *
+ * Safe from interrupt handlers, they hold the kernel lock too.
+ *
+ * @param semaphore The semaphore.
+ */
+void semaphore_up(struct Semaphore* semaphore) {
+    semaphore->count++;
+    wait_queue_wake_one(&semaphore->waiters);
+}
+
+/**
+ * Make the statistics of a lock readable through lockstat.
+ *
+ * @param name What it's shown as, cut to LOCK_NAME_LEN - 1 characters.
+ * @param stats Its statistics, which must outlive the kernel.
+ */
+void lock_stats_register(const char* name, struct LockStats* stats) {
+
+    if (registeredCount == LOCK_STATS_MAX) {
+        return;
+    }
+
+    struct RegisteredLock* lock = &registered[registeredCount++];
+
+    size_t i;
+    for (i = 0; i < LOCK_NAME_LEN - 1 && name[i]; i++) {
+        lock->name[i] = name[i];
+    }
+    lock->name[i] = 0;
+
+    lock->stats = stats;
+}
+
+/**
+ * Read the statistics of a registered lock.
+ *
+ * @param index Which one, in the order they were registered.
+ * @param info Where to write them.
+ *
+ * @return 0 on success, -1 if there's no such lock.
+ */
+int lock_stats_read(size_t index, struct LockInfo* info) {
+
+    if (index >= registeredCount) {
+        return -1;
+    }
+
+    for (size_t i = 0; i < LOCK_NAME_LEN; i++) {
+        info->name[i] = registered[index].name[i];
+    }
+
+    info->acquired = registered[index].stats->acquired;
+    info->contended = registered[index].stats->contended;
+    info->waitCycles = registered[index].stats->waitCycles;
+
+    return 0;
+}
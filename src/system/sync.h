@@ -0,0 +1,122 @@
+#ifndef __SYSTEM_SYNC__
+#define __SYSTEM_SYNC__
+
+#include "system/processQueue.h"
+#include "type.h"
+
+struct Process;
+
+/**
+ * How often a lock was taken, and how much it cost to get it.
+ *
+ * Only updated by whoever holds the lock, so they need no lock of their own.
+ */
+struct LockStats {
+    size_t acquired;
+    // Times it was already held when someone asked for it
+    size_t contended;
+    // TSC cycles spent spinning or sleeping on it
+    unsigned long long waitCycles;
+};
+
+/**
+ * A ticket lock. CPUs get it in the order they asked for it, so none of
+ * them can starve while the others keep taking it.
+ */
+struct Spinlock {
+    volatile unsigned short next;
+    volatile unsigned short serving;
+    struct LockStats stats;
+};
+
+#define SPINLOCK_INIT { 0, 0, { 0, 0, 0 } }
+
+/**
+ * Processes blocked until something happens.
+ *
+ * When a process is what they're waiting for, it can be made the owner,
+ * and then it runs at least at the priority of the most urgent of them.
+ */
+struct WaitQueue {
+    struct ProcessQueue processes;
+    struct Process* owner;
+    // Links the queues of the same owner
+    struct WaitQueue* ownedNext;
+};
+
+#define WAIT_QUEUE_INIT { { 0, 0, 0 }, 0, 0 }
+
+// How far along a chain of owners a change of priority is passed
+#define INHERIT_DEPTH 8
+
+/**
+ * A lock that processes sleep on while someone else holds it.
+ *
+ * The holder is the owner of the wait queue, so it runs at least at the
+ * priority of the most urgent process waiting for it. Its state is covered
+ * by the kernel lock, which every caller already holds. Holding it while
+ * sleeping is what it's for.
+ */
+struct Mutex {
+    struct WaitQueue waiters;
+    struct LockStats stats;
+};
+
+#define MUTEX_INIT { WAIT_QUEUE_INIT, { 0, 0, 0 } }
+
+/**
+ * A count of units that processes sleep on until there's one for them.
+ *
+ * Like the mutex, its state is covered by the kernel lock. Interrupt
+ * handlers hold that too, so they can give units back.
+ */
+struct Semaphore {
+    int count;
+    struct WaitQueue waiters;
+    struct LockStats stats;
+};
+
+#define SEMAPHORE_INIT(count) { (count), WAIT_QUEUE_INIT, { 0, 0, 0 } }
+
+// How many locks can report their statistics, see lock_stats_register
+#define LOCK_STATS_MAX 16
+
+void spin_init(struct Spinlock* lock);
+
+void spin_lock(struct Spinlock* lock);
+
+void spin_unlock(struct Spinlock* lock);
+
+unsigned int spin_lock_irqsave(struct Spinlock* lock);
+
+void spin_unlock_irqrestore(struct Spinlock* lock, unsigned int flags);
+
+void wait_queue_init(struct WaitQueue* queue);
+
+void wait_queue_sleep(struct WaitQueue* queue);
+
+int wait_queue_wake_one(struct WaitQueue* queue);
+
+size_t wait_queue_wake_all(struct WaitQueue* queue);
+
+void wait_queue_set_owner(struct WaitQueue* queue, struct Process* owner);
+
+void wait_queue_update_priority(struct Process* process);
+
+void mutex_init(struct Mutex* mutex);
+
+void mutex_lock(struct Mutex* mutex);
+
+void mutex_unlock(struct Mutex* mutex);
+
+void semaphore_init(struct Semaphore* semaphore, int count);
+
+void semaphore_down(struct Semaphore* semaphore);
+
+void semaphore_up(struct Semaphore* semaphore);
+
+void lock_stats_register(const char* name, struct LockStats* stats);
+
+int lock_stats_read(size_t index, struct LockInfo* info);
+
+#endif
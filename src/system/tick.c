@@ -1,5 +1,8 @@
 #include "system/tick.h"
 #include "system/call.h"
+#include "system/wheel.h"
+#include "system/scheduler.h"
+#include "system/smp.h"
 #include "type.h"
 
 static size_t ticksSinceStart = 0;
@@ -7,11 +10,25 @@ static size_t ticksSinceStart = 0;
 /**
  * Increment the amoun of ticks since processor's start.
  *
- * Called when IRQ0 is triggered.
+ * Called when IRQ0 is triggered. Every CPU ticks, but only the boot CPU keeps time.
  *
  */
 void timerTick(void) {
-    ticksSinceStart++;
+    if (smp_cpu()->index == 0) {
+        ticksSinceStart++;
+        wheel_advance(ticksSinceStart);
+    }
+    scheduler_tick();
+}
+
+/**
+ * Account for ticks that happened without a timer interrupt.
+ *
+ * @param ticks The number of ticks to add.
+ */
+void addTicks(size_t ticks) {
+    ticksSinceStart += ticks;
+    wheel_advance(ticksSinceStart);
 }
 
 /**
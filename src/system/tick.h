@@ -4,6 +4,8 @@
 
 void timerTick(void);
 
+void addTicks(size_t ticks);
+
 size_t _getTicksSinceStart(void);
 
 #endif
@@ -0,0 +1,285 @@
+#include "system/timer.h"
+#include "system/tick.h"
+#include "system/apic.h"
+#include "system/cpu.h"
+#include "system/io.h"
+#include "system/common.h"
+#include "system/scheduler.h"
+#include "system/wheel.h"
+#include "system/smp.h"
+#include "library/div64.h"
+
+#define PIT_FREQUENCY 1193182u
+
+#define PIT_CHANNEL0 0x40
+#define PIT_CHANNEL2 0x42
+#define PIT_COMMAND 0x43
+#define PIT_GATE 0x61
+
+#define PIT_CHANNEL0_PERIODIC 0x34
+#define PIT_CHANNEL0_ONESHOT 0x30
+#define PIT_CHANNEL2_ONESHOT 0xB0
+
+#define PIT_GATE_ENABLE 0x01
+#define PIT_SPEAKER 0x02
+#define PIT_CHANNEL2_OUT 0x20
+
+#define PIC1_DATA 0x21
+#define PIT_IRQ_MASK 0x01
+
+#define CALIBRATION_HZ 100
+
+// LAPIC timer counts at bus speed / 16
+#define LAPIC_DIVIDE_16 0x3
+
+// Longest we stay without ticks while idle
+#define TICKLESS_MAX_TICKS HZ
+
+static unsigned long long tscHz = 0;
+
+static unsigned long long bootCycles = 0;
+
+static unsigned int lapicPerTick = 0;
+
+static int tickless = 0;
+
+// LAPIC timer interrupts per tick, each CPU catches up on its next one
+static volatile unsigned int samplesPerTick = 1;
+
+static unsigned long long idleStart;
+
+static void calibrate(void);
+
+static void pit_program(int mode, unsigned int count);
+
+static void periodic(void);
+
+void pit_program(int mode, unsigned int count) {
+    outB(PIT_COMMAND, mode);
+    outB(PIT_CHANNEL0, count & 0xFF);
+    outB(PIT_CHANNEL0, (count >> 8) & 0xFF);
+}
+
+/**
+ * Measure the TSC, and the LAPIC timer if there's one, against PIT channel 2.
+ */
+void calibrate(void) {
+
+    unsigned int count = PIT_FREQUENCY / CALIBRATION_HZ;
+    unsigned char gate = inB(PIT_GATE);
+
+    outB(PIT_GATE, (gate & ~PIT_SPEAKER) | PIT_GATE_ENABLE);
+    outB(PIT_COMMAND, PIT_CHANNEL2_ONESHOT);
+    outB(PIT_CHANNEL2, count & 0xFF);
+    outB(PIT_CHANNEL2, (count >> 8) & 0xFF);
+
+    if (lapic_present()) {
+        lapic_write(LAPIC_LVT_TIMER, LAPIC_MASKED);
+        lapic_write(LAPIC_TIMER_DIVIDE, LAPIC_DIVIDE_16);
+        lapic_write(LAPIC_TIMER_INITIAL, 0xFFFFFFFF);
+    }
+
+    unsigned long long start = rdtsc();
+    while (!(inB(PIT_GATE) & PIT_CHANNEL2_OUT));
+    unsigned long long end = rdtsc();
+
+    if (lapic_present()) {
+        lapicPerTick = (0xFFFFFFFF - lapic_read(LAPIC_TIMER_CURRENT)) * CALIBRATION_HZ / HZ;
+        lapic_write(LAPIC_TIMER_INITIAL, 0);
+    }
+
+    outB(PIT_GATE, gate);
+
+    tscHz = (end - start) * CALIBRATION_HZ;
+}
+
+void periodic(void) {
+
+    if (lapicPerTick) {
+        struct Cpu* cpu = smp_cpu();
+        cpu->subTick = 0;
+        lapic_write(LAPIC_TIMER_DIVIDE, LAPIC_DIVIDE_16);
+        lapic_write(LAPIC_LVT_TIMER, TIMER_VECTOR | LAPIC_TIMER_PERIODIC);
+        lapic_write(LAPIC_TIMER_INITIAL, lapicPerTick / cpu->samplesPerTick);
+    } else {
+        pit_program(PIT_CHANNEL0_PERIODIC, PIT_FREQUENCY / HZ);
+    }
+}
+
+/**
+ * Start ticking at HZ.
+ *
+ * The local APIC timer is preferred when there's one, the PIT is masked then.
+ */
+void timer_init(void) {
+
+    if (cpu_has(CPU_TSC)) {
+        calibrate();
+        bootCycles = rdtsc();
+    }
+
+    if (lapicPerTick) {
+        outB(PIC1_DATA, inB(PIC1_DATA) | PIT_IRQ_MASK);
+    }
+
+    smp_cpu()->samplesPerTick = 1;
+    periodic();
+}
+
+/**
+ * Start ticking on an application processor, with the calibration the boot CPU did.
+ *
+ * Without a local APIC timer, they don't tick at all, and only run when kicked.
+ */
+void timer_init_cpu(void) {
+
+    if (lapicPerTick) {
+        smp_cpu()->samplesPerTick = samplesPerTick;
+        periodic();
+    }
+}
+
+/**
+ * Make every CPU's local APIC timer interrupt hz times a second, for the profiler.
+ *
+ * Only every so many of those interrupts are ticks, see timer_lapic_tick.
+ * Without a local APIC timer, the profiler has to make do with samples
+ * taken on every tick, on the boot CPU.
+ *
+ * @param hz Samples per second, 0 to go back to one per tick.
+ *
+ * @return 1 if every CPU samples at hz, 0 if samples come with ticks.
+ */
+int timer_sampling(unsigned int hz) {
+
+    if (!lapicPerTick) {
+        return 0;
+    }
+
+    samplesPerTick = hz > HZ ? hz / HZ : 1;
+    return samplesPerTick > 1;
+}
+
+/**
+ * Called on every local APIC timer interrupt, tells whether it's a tick.
+ *
+ * If the profiler changed the rate, this is where this CPU's timer follows.
+ */
+int timer_lapic_tick(void) {
+
+    struct Cpu* cpu = smp_cpu();
+
+    if (cpu->samplesPerTick != samplesPerTick) {
+        cpu->samplesPerTick = samplesPerTick;
+        periodic();
+    }
+
+    int tick = cpu->subTick == 0;
+    if (++cpu->subTick == cpu->samplesPerTick) {
+        cpu->subTick = 0;
+    }
+
+    return tick;
+}
+
+/**
+ * Halt until the next interrupt, without ticking while at it.
+ *
+ * Called by the idle process. If anything else is runnable it just returns.
+ * Only the boot CPU, which keeps time, stops ticking.
+ */
+void timer_idle(void) {
+
+    disableInterrupts();
+
+    if (scheduler_runnable() > 1) {
+        enableInterrupts();
+        return;
+    }
+
+    if (!tscHz || wheel_pending() || smp_cpu()->index != 0) {
+        // Someone's sleeping, so keep ticking to wake them up on time
+        __asm__ __volatile__ ("sti; hlt");
+        return;
+    }
+
+    tickless = 1;
+    idleStart = rdtsc();
+
+    if (lapicPerTick) {
+        lapic_write(LAPIC_LVT_TIMER, TIMER_VECTOR);
+        lapic_write(LAPIC_TIMER_INITIAL, lapicPerTick * TICKLESS_MAX_TICKS);
+    } else {
+        // That's as long as the PIT can go, about 55ms
+        pit_program(PIT_CHANNEL0_ONESHOT, 0xFFFF);
+    }
+
+    // sti only takes effect after hlt, so nothing can slip in between
+    __asm__ __volatile__ ("sti; hlt");
+}
+
+/**
+ * Go back to periodic ticks, if we were idling.
+ *
+ * Called on every interrupt. Accounts for the ticks that were skipped.
+ *
+ * @param intNum The interrupt being handled.
+ */
+void timer_resume(int intNum) {
+
+    if (!tickless || smp_cpu()->index != 0) {
+        return;
+    }
+
+    tickless = 0;
+    periodic();
+
+    unsigned long long cyclesPerTick = uint64_div32(tscHz, HZ);
+    size_t elapsed = uint64_div64(rdtsc() - idleStart, cyclesPerTick);
+
+    // The timer interrupt counts one on its own, unless IRQ0 is the profiler's
+    int tick = lapicPerTick ? intNum == TIMER_VECTOR : intNum == 0x20;
+    if (tick && elapsed) {
+        elapsed--;
+    }
+
+    addTicks(elapsed);
+}
+
+/**
+ * Nanoseconds since the timer was set up.
+ */
+unsigned long long timer_nanoseconds(void) {
+
+    if (!tscHz) {
+        return (unsigned long long) _getTicksSinceStart() * (NSEC_PER_SEC / HZ);
+    }
+
+    unsigned long long cycles = rdtsc() - bootCycles;
+    unsigned long long seconds = uint64_div64(cycles, tscHz);
+    unsigned long long rest = uint64_mod64(cycles, tscHz);
+
+    return seconds * NSEC_PER_SEC + uint64_div64(rest * NSEC_PER_SEC, tscHz);
+}
+
+unsigned long long timer_cycles_per_second(void) {
+    return tscHz;
+}
+
+/**
+ * The number of ticks that cover at least ns nanoseconds.
+ *
+ * One extra tick is added, since the current one is already partly gone.
+ *
+ * @param ns The time span.
+ *
+ * @return The ticks to wait for, 0 if ns is 0.
+ */
+size_t timer_ticks(unsigned long long ns) {
+
+    if (ns == 0) {
+        return 0;
+    }
+
+    return uint64_div64(ns + NSEC_PER_TICK - 1, NSEC_PER_TICK) + 1;
+}
@@ -0,0 +1,52 @@
+#ifndef __SYSTEM_TIMER__
+#define __SYSTEM_TIMER__
+
+#include "type.h"
+
+// Timer interrupts per second, can be set at build time with HZ=
+#ifndef HZ
+#define HZ 100
+#endif
+
+#define NSEC_PER_SEC 1000000000u
+#define NSEC_PER_MSEC 1000000u
+#define NSEC_PER_TICK (NSEC_PER_SEC / HZ)
+
+// Time slicing tunables for the fair policy, can be set at build time too.
+// Preemption only happens on ticks, so nothing finer than NSEC_PER_TICK is enforced.
+// Every runnable process should run once per latency period
+#ifndef SCHED_LATENCY_NS
+#define SCHED_LATENCY_NS (6 * NSEC_PER_MSEC)
+#endif
+
+// The shortest slice a process gets, the period grows when there are many
+#ifndef SCHED_MIN_GRANULARITY_NS
+#define SCHED_MIN_GRANULARITY_NS 750000u
+#endif
+
+// How far ahead a waking process must be to preempt the current one
+#ifndef SCHED_WAKEUP_GRANULARITY_NS
+#define SCHED_WAKEUP_GRANULARITY_NS (1 * NSEC_PER_MSEC)
+#endif
+
+#define TIMER_VECTOR 0x30
+
+void timer_init(void);
+
+void timer_init_cpu(void);
+
+int timer_sampling(unsigned int hz);
+
+int timer_lapic_tick(void);
+
+void timer_idle(void);
+
+void timer_resume(int intNum);
+
+unsigned long long timer_nanoseconds(void);
+
+unsigned long long timer_cycles_per_second(void);
+
+size_t timer_ticks(unsigned long long ns);
+
+#endif
@@ -0,0 +1,94 @@
+GLOBAL _trampolineStart, _trampolineEnd, _trampolineData
+
+; Must match TRAMPOLINE_BASE and SMP_MAX_CPUS in system/smp.h
+TRAMPOLINE_BASE equ 0x8000
+SMP_MAX_CPUS equ 8
+
+%define ABSOLUTE(label) (TRAMPOLINE_BASE + (label) - _trampolineStart)
+
+SECTION .text
+
+; Application processors start here, in real mode, after the startup IPI.
+; smp_init copies this to TRAMPOLINE_BASE first, so every address is taken
+; relative to the start. It turns on protected mode and paging with what
+; the boot CPU left in _trampolineData, and jumps to the C entry point.
+[BITS 16]
+_trampolineStart:
+    cli
+    cld
+
+    mov ax, cs
+    mov ds, ax
+    lgdt [gdtr - _trampolineStart]
+
+    mov eax, cr0
+    or eax, 1
+    mov cr0, eax
+
+    jmp dword 0x08:ABSOLUTE(protected)
+
+[BITS 32]
+protected:
+    mov ax, 0x10
+    mov ds, ax
+    mov es, ax
+    mov fs, ax
+    mov gs, ax
+    mov ss, ax
+
+    mov ebx, ABSOLUTE(_trampolineData)
+
+    ; CR4 first, large pages must be on before paging is
+    mov eax, [ebx + 4]
+    mov cr4, eax
+    mov eax, [ebx]
+    mov cr3, eax
+    mov eax, cr0
+    or eax, 0x80000000
+    mov cr0, eax
+
+    ; Every CPU has its own slot, found by its local APIC id, so one that
+    ; shows up after smp_init gave up on it can't take another one's stack
+    mov eax, [ebx + 12]
+    mov eax, [eax]
+    shr eax, 24
+    lea esi, [ebx + 16]
+    mov ecx, SMP_MAX_CPUS
+.find:
+    cmp [esi], eax
+    je .found
+    add esi, 8
+    loop .find
+    jmp .halt
+.found:
+    mov esp, [esi + 4]
+    test esp, esp
+    jz .halt
+
+    mov eax, [ebx + 8]
+    call eax
+
+.halt:
+    hlt
+    jmp .halt
+
+align 8
+gdt:
+    dq 0
+    dq 0x00CF9A000000FFFF
+    dq 0x00CF92000000FFFF
+
+gdtr:
+    dw 3 * 8 - 1
+    dd ABSOLUTE(gdt)
+
+; Filled in by smp_init, and each slot's stack before its startup IPI, see struct TrampolineData
+align 4
+_trampolineData:
+    dd 0    ; CR3
+    dd 0    ; CR4
+    dd 0    ; Entry point
+    dd 0    ; Local APIC id register
+    times SMP_MAX_CPUS dd 0, 0    ; Local APIC id and stack of each CPU
+
+_trampolineEnd:
@@ -0,0 +1,188 @@
+#include "system/wheel.h"
+#include "library/stdlib.h"
+
+#define SLOT_MASK (WHEEL_SLOTS - 1)
+
+static struct TimerEvent* wheel[WHEEL_LEVELS][WHEEL_SLOTS];
+
+// The last tick that was processed
+static size_t current = 0;
+
+static size_t pending = 0;
+
+static void file_event(struct TimerEvent* event);
+
+static void cascade(size_t level);
+
+static void tick(void);
+
+/**
+ * Put an event in the slot matching how far away it is.
+ *
+ * @param event The event, with expires already set.
+ */
+void file_event(struct TimerEvent* event) {
+
+    size_t delta = event->expires - current;
+    size_t expires = event->expires;
+    size_t level = 0;
+
+    if (delta > WHEEL_MAX_TICKS) {
+        expires = current + WHEEL_MAX_TICKS;
+        delta = WHEEL_MAX_TICKS;
+    }
+
+    while (level < WHEEL_LEVELS - 1 && delta >= (1u << (WHEEL_BITS * (level + 1)))) {
+        level++;
+    }
+
+    struct TimerEvent** slot = &wheel[level][(expires >> (WHEEL_BITS * level)) & SLOT_MASK];
+
+    event->next = *slot;
+    if (*slot) {
+        (*slot)->pprev = &event->next;
+    }
+    event->pprev = slot;
+    *slot = event;
+}
+
+/**
+ * Move every event in the current slot of a level to the levels below.
+ *
+ * @param level The level to empty a slot from, at least 1.
+ */
+void cascade(size_t level) {
+
+    size_t index = (current >> (WHEEL_BITS * level)) & SLOT_MASK;
+    struct TimerEvent* event = wheel[level][index];
+    struct TimerEvent* next;
+
+    wheel[level][index] = NULL;
+
+    // An empty slot here means every level above it is also at the start of a turn
+    if (index == 0 && level < WHEEL_LEVELS - 1) {
+        cascade(level + 1);
+    }
+
+    while (event != NULL) {
+        next = event->next;
+        file_event(event);
+        event = next;
+    }
+}
+
+/**
+ * Process a single tick, running every event that expires on it.
+ */
+void tick(void) {
+
+    current++;
+
+    size_t index = current & SLOT_MASK;
+    if (index == 0) {
+        cascade(1);
+    }
+
+    struct TimerEvent* event = wheel[0][index];
+    wheel[0][index] = NULL;
+
+    while (event != NULL) {
+
+        struct TimerEvent* next = event->next;
+
+        event->next = NULL;
+        event->pprev = NULL;
+        pending--;
+
+        // The callback is free to arm the event again
+        event->callback(event->data);
+
+        event = next;
+    }
+}
+
+/**
+ * Set up an event so it can be added or cancelled.
+ *
+ * @param event The event.
+ * @param callback What to call when it expires, from the timer interrupt.
+ * @param data The argument for the callback.
+ */
+void wheel_event_init(struct TimerEvent* event, TimerCallback callback, void* data) {
+    event->next = NULL;
+    event->pprev = NULL;
+    event->expires = 0;
+    event->callback = callback;
+    event->data = data;
+}
+
+/**
+ * Arm an event to expire after a number of ticks.
+ *
+ * If the event was already armed, it's moved.
+ *
+ * @param event The event.
+ * @param ticks How many ticks from now, at least 1.
+ */
+void wheel_add(struct TimerEvent* event, size_t ticks) {
+
+    wheel_cancel(event);
+
+    if (ticks == 0) {
+        ticks = 1;
+    }
+
+    event->expires = current + ticks;
+    file_event(event);
+    pending++;
+}
+
+/**
+ * Disarm an event. Does nothing if it isn't armed.
+ *
+ * @param event The event.
+ */
+void wheel_cancel(struct TimerEvent* event) {
+
+    if (event->pprev == NULL) {
+        return;
+    }
+
+    *event->pprev = event->next;
+    if (event->next) {
+        event->next->pprev = event->pprev;
+    }
+
+    event->next = NULL;
+    event->pprev = NULL;
+    pending--;
+}
+
+int wheel_event_pending(const struct TimerEvent* event) {
+    return event->pprev != NULL;
+}
+
+/**
+ * The number of armed events.
+ */
+size_t wheel_pending(void) {
+    return pending;
+}
+
+/**
+ * Process every tick up to now.
+ *
+ * @param now The current tick count.
+ */
+void wheel_advance(size_t now) {
+
+    if (pending == 0) {
+        // Nothing can expire, so there's no need to walk the slots
+        current = now;
+        return;
+    }
+
+    while (current != now) {
+        tick();
+    }
+}
@@ -0,0 +1,37 @@
+#ifndef __SYSTEM_WHEEL__
+#define __SYSTEM_WHEEL__
+
+#include "type.h"
+
+// 4 levels of 64 slots, each level's slot spans a whole turn of the one below
+#define WHEEL_BITS 6
+#define WHEEL_SLOTS (1u << WHEEL_BITS)
+#define WHEEL_LEVELS 4
+
+// Events further away than this are parked in the last slot, and re-filed on cascade
+#define WHEEL_MAX_TICKS ((1u << (WHEEL_BITS * WHEEL_LEVELS)) - 1)
+
+typedef void (*TimerCallback)(void* data);
+
+struct TimerEvent {
+    struct TimerEvent* next;
+    // Points to whatever points at us, so unlinking needs no list head
+    struct TimerEvent** pprev;
+    size_t expires;
+    TimerCallback callback;
+    void* data;
+};
+
+void wheel_event_init(struct TimerEvent* event, TimerCallback callback, void* data);
+
+void wheel_add(struct TimerEvent* event, size_t ticks);
+
+void wheel_cancel(struct TimerEvent* event);
+
+int wheel_event_pending(const struct TimerEvent* event);
+
+size_t wheel_pending(void);
+
+void wheel_advance(size_t now);
+
+#endif
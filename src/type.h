@@ -11,16 +11,175 @@ typedef unsigned int time_t;
 
 typedef int pid_t;
 
-struct ProcessInfo {
+struct timespec {
+    time_t tv_sec;
+    long tv_nsec;
+};
+
+// Bump when ProcessSnapshot changes in a way old callers can't handle
+#define PSNAPSHOT_VERSION 1
+
+#define PSTATE_RUNNING 0
+#define PSTATE_READY 1
+#define PSTATE_BLOCKED 2
+#define PSTATE_ZOMBIE 3
+
+struct ProcessSnapshotHeader {
+    // Set by the caller to the version it understands
+    unsigned int version;
+    // Size of each entry, entries are this far apart in the buffer
+    size_t entrySize;
+    // Increases by one with every snapshot taken
+    unsigned int generation;
+    // Entries written, and processes that existed
+    size_t count;
+    size_t total;
+    // The TSC when the snapshot was taken, to turn deltas into percentages
+    unsigned long long cycles;
+};
+
+struct ProcessSnapshot {
     pid_t pid;
     pid_t ppid;
+    // What it runs at, which can be above what its nice value gives while it holds others up
     int priority;
     int state;
-    //startDate;
-    //uid;
-    //gid;
-    int cputime;
     time_t timeStart;
+    // Cycles it ran for, and cycles it was ready but waiting to run
+    unsigned long long cycles;
+    unsigned long long waitCycles;
+    size_t voluntarySwitches;
+    size_t involuntarySwitches;
+    size_t memoryPages;
+    // Hardware counters, 0 when the CPU has no PMU
+    unsigned long long instructions;
+    unsigned long long cacheMisses;
+    unsigned long long branchMisses;
+    // The process a thread belongs to, pid itself for processes
+    pid_t tgid;
+    // Deadline class jobs that finished late, and times they ran out of budget
+    size_t deadlineMisses;
+    size_t deadlineOverruns;
+    // What it's scheduled by, one of the SCHED_ policies or SCHED_DEADLINE
+    int policy;
+    int nice;
+};
+
+#define SYSCALL_NAME_LEN 16
+
+struct SyscallInfo {
+    char name[SYSCALL_NAME_LEN];
+    size_t calls;
+    // Cycles spent inside the call, including any time it was blocked
+    unsigned long long cycles;
+    unsigned long long maxCycles;
+};
+
+#define LOCK_NAME_LEN 16
+
+struct LockInfo {
+    char name[LOCK_NAME_LEN];
+    size_t acquired;
+    // Times it was already held when someone asked for it
+    size_t contended;
+    // TSC cycles spent spinning or sleeping on it
+    unsigned long long waitCycles;
+};
+
+#define PERF_CYCLES 0
+#define PERF_INSTRUCTIONS 1
+#define PERF_CACHE_MISSES 2
+#define PERF_BRANCH_MISSES 3
+#define PERF_EVENTS 4
+
+#define PERF_SELF 0
+#define PERF_CHILDREN 1
+
+struct PerfCounters {
+    // Bit (1 << event) is set for every event that is being counted
+    unsigned int available;
+    unsigned long long counts[PERF_EVENTS];
+};
+
+#define PROFILE_START 0
+#define PROFILE_STOP 1
+#define PROFILE_READ 2
+#define PROFILE_DROPPED 3
+
+struct ProfileSample {
+    unsigned int eip;
+    pid_t pid;
+    // The CPU it was taken on
+    unsigned int cpu;
+};
+
+#define FUTEX_WOKEN 0
+#define FUTEX_CHANGED 1
+#define FUTEX_TIMEDOUT 2
+
+// A reservation in the deadline class, in nanoseconds.
+// runtime <= deadline <= period must hold, and period can't be over a second.
+struct DeadlineParams {
+    unsigned long long runtime;
+    unsigned long long deadline;
+    unsigned long long period;
+};
+
+#define DEADLINE_INVALID -1
+// Admitting it would overcommit the CPU
+#define DEADLINE_REFUSED -2
+
+// Scheduling policies, see sched_setscheduler
+#define SCHED_DEFAULT -1
+#define SCHED_ROUND_ROBIN 0
+#define SCHED_PRIORITY 1
+#define SCHED_MULTILEVEL 2
+#define SCHED_FAIR 3
+#define SCHED_POLICIES 4
+// Only reported, processes get there with sched_setdeadline
+#define SCHED_DEADLINE 4
+
+// Nice values, see nice and setpriority. The lower, the more CPU time a process gets.
+#define NICE_MIN -20
+#define NICE_MAX 19
+
+// Processes run at priority NICE_MAX - nice, higher ones first
+#define PRIORITY_LEVELS 40
+
+// What each kmalloc size class holds, and how much it was used
+struct SlabCacheStats {
+    size_t objectSize;
+    size_t objectsPerSlab;
+    size_t slabs;
+    size_t active;
+    size_t allocs;
+    size_t frees;
+};
+
+// How much is mapped at each page size
+struct PagingStats {
+    // 4 MiB mappings
+    size_t largePages;
+    // 4 KiB mappings, across every address space
+    size_t smallPages;
+};
+
+#define MEMSTAT_CACHES 8
+
+struct MemStats {
+    // Size classes filled in, smallest first
+    size_t caches;
+    struct SlabCacheStats cache[MEMSTAT_CACHES];
+    struct PagingStats paging;
+};
+
+#define KSYMBOL_NAME_LEN 32
+
+struct KernelSymbol {
+    unsigned int address;
+    // Distance to the next symbol, 0 for the last one
+    size_t size;
+    char name[KSYMBOL_NAME_LEN];
 };
 
 #endif